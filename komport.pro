@@ -10,6 +10,7 @@ greaterThan(QT_MAJOR_VERSION, 4) {
 
 TARGET = komport
 TEMPLATE = app
+CONFIG += c++11
 
 
 unix{
@@ -25,8 +26,15 @@ unix{
 SOURCES += src/main.cpp \
     src/komport.cpp \
     src/cserial.cpp \
+    src/cserialthread.cpp \
+    src/cringbuffer.cpp \
+    src/csimd.cpp \
+    src/cglyphcache.cpp \
+    src/cscrollback.cpp \
+    src/cstyletable.cpp \
+    src/clogsearch.cpp \
+    src/clogdialog.cpp \
     src/cdevicelock.cpp \
-    src/ccharcell.cpp \
     src/ccellarray.cpp \
     src/cscreen.cpp \
     src/cemulation.cpp \
@@ -34,6 +42,14 @@ SOURCES += src/main.cpp \
 
 HEADERS += src/komport.h \
     src/cserial.h \
+    src/cserialthread.h \
+    src/cringbuffer.h \
+    src/csimd.h \
+    src/cglyphcache.h \
+    src/cscrollback.h \
+    src/cstyletable.h \
+    src/clogsearch.h \
+    src/clogdialog.h \
     src/cdevicelock.h \
     src/ccharcell.h \
     src/ccellarray.h \
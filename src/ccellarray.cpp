@@ -20,14 +20,32 @@
 #include "ccharcell.h"
 #include "cscreen.h"
 
+#include <QFontMetricsF>
+#include <QTransform>
+#include <string.h>
+#include <algorithm>
+
 #define inherited QObject
 
 CCellArray::CCellArray()
 : mScreen(NULL)
 , mCols(0)
 , mRows(0)
-, mSyncBusy(false)
+, mCellWidth(0)
+, mCellHeight(0)
+, mBlinkRowCount(0)
+, mAlternate(false)
+, mOtherBlinkRowCount(0)
+, mUseStaticText(false)
+, mTextCellWidth(0)
+, mTextCellHeight(0)
+, mScrollback(NULL)
+, mViewOffset(0)
+, mHighlightLine(-1)
+, mHighlightCol(0)
+, mHighlightCount(0)
 {
+	mStyles.setCells(this);
 }
 
 CCellArray::~CCellArray()
@@ -41,11 +59,6 @@ CCellArray::~CCellArray()
 void CCellArray::setScreen(CScreen* screen)
 {
 	mScreen = screen;
-	for( int n=0; n < mCells.count(); n++ )
-	{
-		CCellArray& cell = (CCellArray&)mCells.at(n);
-		cell.setScreen(mScreen);
-	}
 }
 
 /**
@@ -57,21 +70,11 @@ void CCellArray::setRect(QRect r)
 	if ( r.width() >  0 && r.height() > 0 )
 	{
 		mRect = r;
-		if ( rows() > 0 && cols() > 0 )
-		{
-			int cellHeight = r.height()/rows();
-			int cellWidth = r.width()/cols();
-			for( int row=0; row < rows(); row++ )
-			{
-				for( int col=0; col < cols(); col++ )
-				{
-					int i = indexOf(col,row);
-					QRect cellRect((col*cellWidth)+r.left(),(row*cellHeight)+r.top(),cellWidth,cellHeight);
-					CCharCell& cell = (CCharCell&)mCells.at(i);
-					cell.setRect(cellRect);
-				}
-			}
-		}
+	}
+	if ( rows() > 0 && cols() > 0 )
+	{
+		mCellHeight = mRect.height()/rows();
+		mCellWidth = mRect.width()/cols();
 	}
 }
 
@@ -81,9 +84,8 @@ void CCellArray::setRect(QRect r)
   */
 void CCellArray::setCols(int cols)
 {
-	mCols=cols;
+	resize(cols,rows());
 	sync();
-	setRect(mRect); /* force re-calculate sizes */
 }
 
 /**
@@ -92,78 +94,474 @@ void CCellArray::setCols(int cols)
  */
 void CCellArray::setRows(int rows)
 {
-	mRows=rows;
+	resize(cols(),rows);
 	sync();
-	setRect(mRect); /* force re-calculate sizes */
 }
 
 /**
- * @param Synchronize the size of the character array with the number of rows and columns.
+ * @brief Re-shape both grids, the top left of the old content is kept.
+ */
+void CCellArray::resize(int cols,int rows)
+{
+	if ( cols < 0 ) cols = 0;
+	if ( rows < 0 ) rows = 0;
+	if ( cols != mCols || rows != mRows )
+	{
+		resizeGrid(cols,rows);
+		swapGrids();
+		resizeGrid(cols,rows);
+		swapGrids();
+		mCols = cols;
+		mRows = rows;
+	}
+}
+
+/**
+ * @brief Re-shape the grid in mCells, mCols and mRows still hold the old shape.
+ */
+void CCellArray::resizeGrid(int cols,int rows)
+{
+	QVector<CCharCell> cells(cols*rows,CCharCell());
+	QVector<int> rowMap(rows);
+	QVector<bool> blinkRows(rows,false);
+	int keepCols = qMin(cols,mCols);
+	int keepRows = qMin(rows,mRows);
+	mBlinkRowCount = 0;
+	for( int row=0; row < rows; row++ )
+	{
+		rowMap[row] = row;
+		if ( row < keepRows )
+		{
+			memcpy(cells.data()+(row*cols),line(row),keepCols*sizeof(CCharCell));
+			if ( rowBlinks(row) )
+			{
+				blinkRows[row] = true;
+				++mBlinkRowCount;
+			}
+		}
+	}
+	mCells.swap(cells);
+	mRowMap.swap(rowMap);
+	mBlinkRows.swap(blinkRows);
+}
+
+/** exchange the shown grid with the other one, only the vectors are swapped */
+void CCellArray::swapGrids()
+{
+	mCells.swap(mOtherCells);
+	mRowMap.swap(mOtherRowMap);
+	mBlinkRows.swap(mOtherBlinkRows);
+	qSwap(mBlinkRowCount,mOtherBlinkRowCount);
+}
+
+/** blank the shown grid */
+void CCellArray::clearGrid()
+{
+	std::fill(mCells.begin(),mCells.end(),CCharCell());
+	mBlinkRows.fill(false);
+	mBlinkRowCount = 0;
+}
+
+/**
+ * @brief Show the alternate grid, or the primary one again.
+ * @brief The grids are exchanged without copying cells. Lines scrolled off the alternate grid
+ * @brief do not go to the scrollback and the view returns to the live grid.
+ * @param clear Blank the alternate grid, after entering it or before leaving it.
+ */
+void CCellArray::setAlternate(bool on, bool clear)
+{
+	if ( clear && mAlternate )
+	{
+		clearGrid();
+	}
+	if ( on != mAlternate )
+	{
+		swapGrids();
+		mAlternate = on;
+		mViewOffset = 0;
+		if ( clear && mAlternate )
+		{
+			clearGrid();
+		}
+	}
+	if ( screen() != NULL )
+	{
+		screen()->invalidate();
+	}
+}
+
+/**
+ * @brief Recalculate the cell geometry and repaint.
  */
 void CCellArray::sync()
 {
-	if ( !mSyncBusy )
+	setRect(mRect); /* recalc cell size */
+	if ( screen() != NULL )
 	{
-		int nCells = rows()*cols();
-		if ( nCells > 0 )
+		screen()->invalidate();
+	}
+}
+
+/** pixel rectangle of a cell */
+QRect CCellArray::cellRect(int col,int row)
+{
+	return QRect(mRect.left()+(col*cellWidth()),mRect.top()+(row*cellHeight()),cellWidth(),cellHeight());
+}
+
+/** pixel rectangle of count cells of a row */
+QRect CCellArray::spanRect(int col,int row,int count)
+{
+	return QRect(mRect.left()+(col*cellWidth()),mRect.top()+(row*cellHeight()),count*cellWidth(),cellHeight());
+}
+
+/** pixel rectangle of count whole rows */
+QRect CCellArray::rowsRect(int row,int count)
+{
+	return QRect(mRect.left(),mRect.top()+(row*cellHeight()),cols()*cellWidth(),count*cellHeight());
+}
+
+/**
+ * @brief Note that a row holds blinking cells, so the blink clock visits it.
+ * @brief The mark follows the row through scrolls, CScreen drops it when the row no longer blinks.
+ */
+void CCellArray::markBlink(int row)
+{
+	bool& blink = mBlinkRows[mRowMap.at(row)];
+	if ( !blink )
+	{
+		blink = true;
+		++mBlinkRowCount;
+	}
+}
+
+/** note that a row holds no blinking cells */
+void CCellArray::unmarkBlink(int row)
+{
+	bool& blink = mBlinkRows[mRowMap.at(row)];
+	if ( blink )
+	{
+		blink = false;
+		--mBlinkRowCount;
+	}
+}
+
+/** set the bit of every style id used by a cell of either grid, a history line or the current rendition */
+void CCellArray::markStyles(QBitArray& used)
+{
+	for( int n=0; n < mCells.count(); n++ )
+	{
+		used.setBit(mCells.at(n).style());
+	}
+	for( int n=0; n < mOtherCells.count(); n++ )
+	{
+		used.setBit(mOtherCells.at(n).style());
+	}
+	if ( mScrollback != NULL )
+	{
+		mScrollback->markStyles(used);
+	}
+	if ( mScreen != NULL )
+	{
+		used.setBit(mScreen->styleId());
+	}
+}
+
+/**
+ * @brief Set count cells of a row to blank, one contiguous fill clipped to the row.
+ * @brief The caller records the damage.
+ */
+void CCellArray::fillSpan(int col,int row,int count,const CCharCell& blank)
+{
+	int last = qMin(col+count,cols());
+	col = qMax(col,0);
+	if ( row < 0 || row >= rows() || last <= col )
+	{
+		return;
+	}
+	CCharCell* cells = line(row);
+	std::fill(cells+col,cells+last,blank);
+	if ( mStyles.blink(blank.style()) )
+	{
+		markBlink(row);
+	}
+	else if ( col == 0 && last == cols() )
+	{
+		unmarkBlink(row);
+	}
+}
+
+/** set count whole rows to blank, each row is one contiguous fill */
+void CCellArray::fillRows(int row,int count,const CCharCell& blank)
+{
+	for( int y=qMax(row,0); y < qMin(row+count,rows()); y++ )
+	{
+		fillSpan(0,y,cols(),blank);
+	}
+}
+
+/** set a rectangle of cells to blank */
+void CCellArray::fillRect(const QRect& r,const CCharCell& blank)
+{
+	for( int y=r.top(); y <= r.bottom(); y++ )
+	{
+		fillSpan(r.left(),y,r.width(),blank);
+	}
+}
+
+/** the foreground color of a style id */
+QColor CCellArray::foregroundColor(quint16 style)
+{
+	QRgb fg = mStyles.foreground(style);
+	if ( fg == CStyleTable::defaultColor )
+	{
+		return screen()->defaultForegroundColor();
+	}
+	return QColor::fromRgb(mStyles.rgb(fg));
+}
+
+/** the background color of a style id */
+QColor CCellArray::backgroundColor(quint16 style)
+{
+	QRgb bg = mStyles.background(style);
+	if ( bg == CStyleTable::defaultColor )
+	{
+		return screen()->defaultBackgroundColor();
+	}
+	return QColor::fromRgb(mStyles.rgb(bg));
+}
+
+/**
+ * @brief Draw the cells.
+ * @param rect the paint rect
+ */
+void CCellArray::draw(QPainter& painter, const QRect& rect)
+{
+	if ( cols() <= 0 || rows() <= 0 || cellWidth() <= 0 || cellHeight() <= 0 )
+	{
+		return;
+	}
+	int firstCol = qMax(0,(rect.left()-mRect.left())/cellWidth());
+	int lastCol = qMin(cols()-1,(rect.right()-mRect.left())/cellWidth());
+	int firstRow = qMax(0,(rect.top()-mRect.top())/cellHeight());
+	int lastRow = qMin(rows()-1,(rect.bottom()-mRect.top())/cellHeight());
+
+	if ( staticText() )
+	{
+		setupTextFonts();
+	}
+	else
+	{
+		mGlyphs.setCellSize(cellWidth(),cellHeight());
+	}
+
+	for( int row=firstRow; row <= lastRow; row++ )
+	{
+		const CCharCell* cells = viewLine(row);
+		if ( (historyLines()-mViewOffset)+row == mHighlightLine )
+		{
+			/* draw the marked cells as selected */
+			if ( cells != mViewRow.constData() )
+			{
+				mViewRow.resize(cols());
+				memcpy(mViewRow.data(),cells,cols()*sizeof(CCharCell));
+			}
+			for( int n=qMax(mHighlightCol,0); n < qMin(mHighlightCol+mHighlightCount,cols()); n++ )
+			{
+				mViewRow[n].setSelect(!mViewRow[n].select());
+			}
+			cells = mViewRow.constData();
+		}
+		int col=firstCol;
+		while ( col <= lastCol )
 		{
-			int diff = nCells - mCells.count();
-			mSyncBusy=true;
-			while (diff!=0)
+			/* a run of cells drawn alike */
+			const CCharCell& c = cells[col];
+			quint32 rendition = c.rendition();
+			int end=col+1;
+			while ( end <= lastCol && cells[end].rendition() == rendition )
+			{
+				++end;
+			}
+			QRect r = spanRect(col,row,end-col);
+			quint16 attributes = mStyles.attributes(c.style());
+			QColor fg = foregroundColor(c.style());
+			QColor bg = backgroundColor(c.style());
+			if ( ( ( ( attributes & CStyleTable::attrReverse ) != 0 ) != c.select() ) != screen()->reverseScreen() )
 			{
-				if ( diff > 0 )
+				qSwap(fg,bg);
+			}
+			painter.fillRect(r,bg);
+			if ( !( attributes & CStyleTable::attrBlink ) || screen()->blinkState() )
+			{
+				drawRun(painter,r.topLeft(),cells+col,end-col,fg);
+				if ( attributes & CStyleTable::attrUnderline )
 				{
-					CCharCell cell(this);
-					mCells.append(cell);
-					--diff;
+					painter.setPen(fg);
+					painter.drawLine(r.bottomLeft(),r.bottomRight());
 				}
-				else
+			}
+			col = end;
+		}
+	}
+}
+
+/**
+ * @brief The cells shown on a row of the view.
+ * @brief While history is shown the grid moves down by the view offset and the rows above it come
+ * @brief from the scrollback, padded with blanks to the width of the grid.
+ */
+const CCharCell* CCellArray::viewLine(int row)
+{
+	if ( row >= mViewOffset )
+	{
+		return line(row-mViewOffset);
+	}
+	int n = (mScrollback->lines()-mViewOffset)+row;
+	int len = qMin(mScrollback->lineLength(n),cols());
+	mViewRow.resize(cols());
+	memcpy(mViewRow.data(),mScrollback->line(n),len*sizeof(CCharCell));
+	std::fill(mViewRow.begin()+len,mViewRow.end(),CCharCell());
+	return mViewRow.constData();
+}
+
+/**
+ * @brief Draw the text of a run of cells sharing one style over its background.
+ * @param pt The top left of the first cell.
+ */
+void CCellArray::drawRun(QPainter& painter, const QPoint& pt, const CCharCell* cells, int count, const QColor& fg)
+{
+	bool bold = mStyles.bold(cells[0].style());
+	if ( staticText() )
+	{
+		/* trailing blanks draw nothing */
+		while ( count > 0 && cells[count-1].codepoint() == ' ' )
+		{
+			--count;
+		}
+		if ( count > 0 )
+		{
+			QVector<uint> ucs4(count+1);
+			ucs4[0] = bold ? 'b' : 'n';
+			for( int n=0; n < count; n++ )
+			{
+				ucs4[n+1] = cells[n].codepoint();
+			}
+			QString key = QString::fromUcs4(ucs4.constData(),ucs4.count());
+			if ( !mStaticText.contains(key) )
+			{
+				if ( mStaticText.count() >= CCELLARRAY_MAX_STATIC_TEXT )
 				{
-					mCells.takeLast();
-					++diff;
+					mStaticText.clear();
 				}
+				QStaticText text(key.mid(1));
+				text.setTextFormat(Qt::PlainText);
+				text.prepare(QTransform(),bold ? mBoldTextFont : mTextFont);
+				mStaticText.insert(key,text);
+			}
+			painter.setFont(bold ? mBoldTextFont : mTextFont);
+			painter.setPen(fg);
+			painter.drawStaticText(pt,mStaticText[key]);
+		}
+	}
+	else
+	{
+		for( int n=0; n < count; n++ )
+		{
+			if ( cells[n].codepoint() != ' ' )
+			{
+				mGlyphs.draw(painter,QPoint(pt.x()+(n*cellWidth()),pt.y()),cells[n].codepoint(),bold,fg);
 			}
 		}
-		mSyncBusy=false;
 	}
-	setRect(mRect); /* recalc cell rects */
-	screen()->update();
+}
+
+/** advance of one character, horizontalAdvance() replaced width() in Qt 5.11 */
+static qreal charAdvance(const QFont& font,QChar ch)
+{
+#if QT_VERSION >= 0x050B00
+	return QFontMetricsF(font).horizontalAdvance(ch);
+#else
+	return QFontMetricsF(font).width(ch);
+#endif
 }
 
 /**
- * @brief Draw the cells.
- * @param rect the paint rect
+ * @brief Build the fonts for static text runs, the letter spacing makes every advance one cell wide.
  */
-void CCellArray::draw(QPainter& painter, const QRect& rect)
+void CCellArray::setupTextFonts()
+{
+	if ( mTextCellWidth != cellWidth() || mTextCellHeight != cellHeight() )
+	{
+		mTextCellWidth = cellWidth();
+		mTextCellHeight = cellHeight();
+		mTextFont = QFont();
+		mTextFont.setFamily("Monospace");
+		mTextFont.setStyleHint(QFont::TypeWriter);
+		mTextFont.setPixelSize(cellHeight());
+		mTextFont.setLetterSpacing(QFont::AbsoluteSpacing,cellWidth()-charAdvance(mTextFont,QChar('M')));
+		mBoldTextFont = mTextFont;
+		mBoldTextFont.setBold(true);
+		mBoldTextFont.setLetterSpacing(QFont::AbsoluteSpacing,cellWidth()-charAdvance(mBoldTextFont,QChar('M')));
+		mStaticText.clear();
+	}
+}
+
+/** draw runs with QStaticText rather than from the glyph atlas */
+void CCellArray::setStaticText(bool b)
 {
-	for(int n=0; n < cells().count(); n++)
+	if ( mUseStaticText != b )
 	{
-		CCharCell& cell = (CCharCell&)cells().at(n);
-		if ( cell.rect().intersects(rect))
+		mUseStaticText = b;
+		mStaticText.clear();
+		if ( screen() != NULL )
 		{
-			cell.draw(painter);
+			screen()->invalidate();
 		}
 	}
 }
 
+/** where lines scrolled off the top of the grid go, NULL to drop them */
+void CCellArray::setScrollback(CScrollback* scrollback)
+{
+	mScrollback = scrollback;
+	setViewOffset(0);
+}
+
 /**
- * @brief Draw the cells.
- * @param rect the paint rect
+ * @brief Show history, the grid moves down by lines rows.
+ * @param lines History lines above the grid, 0 shows the live grid.
  */
-void CCellArray::draw(const QRect& rect)
+void CCellArray::setViewOffset(int lines)
 {
-	for(int n=0; n < cells().count(); n++)
+	lines = ( mScrollback != NULL && !mAlternate ) ? qBound(0,lines,mScrollback->lines()) : 0;
+	if ( mViewOffset != lines )
 	{
-		CCharCell& cell = (CCharCell&)cells().at(n);
-		if ( cell.rect().intersects(rect))
+		mViewOffset = lines;
+		if ( screen() != NULL )
 		{
-			cell.draw();
+			screen()->invalidate();
 		}
 	}
 }
 
+/**
+ * @brief Mark count cells of a line, a search match for instance.
+ * @param line The line counting from the oldest in history, the grid follows the history.
+ */
+void CCellArray::setHighlight(int line, int col, int count)
+{
+	mHighlightLine = line;
+	mHighlightCol = col;
+	mHighlightCount = count;
+	if ( screen() != NULL )
+	{
+		screen()->invalidate();
+	}
+}
+
 /**
   * @brief Scroll a region.
+  * @brief Full width regions rotate the row map, so the cost does not depend on the width.
   * @param mode The scroll mode.
   * @param left The left column of the scroll region.
   * @param top The top row of the scroll region.
@@ -172,51 +570,72 @@ void CCellArray::draw(const QRect& rect)
   */
 void CCellArray::scrollGrid(CCellArray::ScrollMode mode, int col, int row, int width, int height)
 {
-	if ( mode == ScrollUp )
+	col = qMax(col,0);
+	row = qMax(row,0);
+	width = qMin(width,cols()-col);
+	height = qMin(height,rows()-row);
+	if ( width <= 0 || height <= 0 )
 	{
-		/** copy region up... */
-		for(int y=row; y < (row+height); y++)
+		return;
+	}
+	if ( col == 0 && width == cols() )
+	{
+		/** rotate the rows of the region and blank the one that wrapped around... */
+		screen()->aboutToScroll();
+		int* first = mRowMap.data()+row;
+		int* last = first+height;
+		if ( mode == ScrollUp )
+		{
+			std::rotate(first,first+1,last);
+		}
+		else
 		{
-			for(int x=col; x < width; x++)
+			std::rotate(first,last-1,last);
+		}
+		int blank = ( mode == ScrollUp ) ? (row+height)-1 : row;
+		CCharCell* cells = line(blank);
+		if ( mode == ScrollUp && row == 0 && mScrollback != NULL && !mAlternate )
+		{
+			/* the top line of the screen goes to history, a view into history stays on the same lines */
+			mScrollback->append(cells,width);
+			if ( mViewOffset > 0 )
 			{
-				if ( isValidCell(x,y+1) && isValidCell(x,y) )
-				{
-					CCharCell& from = (CCharCell&)cell(x,y+1);
-					CCharCell& to = (CCharCell&)cell(x,y);
-					to = from;
-				}
+				mViewOffset = qMin(mViewOffset+1,mScrollback->lines());
 			}
 		}
-		/** new up the bottom row... */
-		for(int x=col; x < width; x++)
+		fillSpan(0,blank,width,CCharCell());
+		screen()->scrollRows(row,height,( mode == ScrollUp ) ? 1 : -1);
+		return;
+	}
+	else if ( mode == ScrollUp )
+	{
+		/** copy region up... */
+		for(int y=row; y < (row+height)-1; y++)
 		{
-			CCharCell& c = (CCharCell&)cell(x,(row+height)-1);
-			c.clear();
+			memcpy(line(y)+col,line(y+1)+col,width*sizeof(CCharCell));
+			if ( rowBlinks(y+1) )
+			{
+				markBlink(y);
+			}
 		}
+		/** new up the bottom row... */
+		fillSpan(col,(row+height)-1,width,CCharCell());
 	}
 	else if ( mode == ScrollDown )
 	{
 		/** copy region down... */
 		for(int y=(row+height)-1; y>row; y--)
 		{
-			for(int x=col; x < width; x++)
+			memcpy(line(y)+col,line(y-1)+col,width*sizeof(CCharCell));
+			if ( rowBlinks(y-1) )
 			{
-				if ( isValidCell(x,y-1) && isValidCell(x,y) )
-				{
-					CCharCell& from = (CCharCell&)cell(x,y-1);
-					CCharCell& to = (CCharCell&)cell(x,y);
-					to = from;
-				}
+				markBlink(y);
 			}
 		}
 		/** new up the top row... */
-		for(int x=col; x < width; x++)
-		{
-			CCharCell& c = (CCharCell&)cell(x,row);
-			c.clear();
-		}
+		fillSpan(col,row,width,CCharCell());
 	}
-	sync();
+	screen()->invalidate(spanRect(col,row,width).united(spanRect(col,(row+height)-1,width)));
 }
 
 /* Select cells in screen pixel coordinates rectangle */
@@ -224,18 +643,15 @@ void CCellArray::selectCells(QRect r)
 {
 	for( int y=0; y < rows(); y++ )
 	{
+		CCharCell* cells = line(y);
 		for( int x=0; x < cols(); x++ )
 		{
-			CCharCell& c = (CCharCell&)cell(x,y);
-			if ( r.intersects(c.rect()) )
-			{
-				c.setSelect(true);
-			}
-			else
+			bool select = r.intersects(cellRect(x,y));
+			if ( cells[x].select() != select )
 			{
-				c.setSelect(false);
+				cells[x].setSelect(select);
+				screen()->invalidate(cellRect(x,y));
 			}
-			screen()->update(c.rect());
 		}
 	}
 }
@@ -245,16 +661,24 @@ void CCellArray::deselectCells()
 {
 	for( int y=0; y < rows(); y++ )
 	{
+		CCharCell* cells = line(y);
+		int first = -1;
+		int last = -1;
 		for( int x=0; x < cols(); x++ )
 		{
-			CCharCell& c = (CCharCell&)cell(x,y);
-			if ( c.select() )
+			if ( cells[x].select() )
 			{
-				c.setSelect(false);
+				cells[x].setSelect(false);
+				if ( first < 0 )
+				{
+					first = x;
+				}
+				last = x;
 			}
 		}
+		if ( first >= 0 )
+		{
+			screen()->invalidate(spanRect(first,y,(last-first)+1));
+		}
 	}
-	screen()->update();
 }
-
-
@@ -20,9 +20,21 @@
 #define CCELLARRAY_H
 
 #include "ccharcell.h"
+#include "cglyphcache.h"
+#include "cscrollback.h"
+#include "cstyletable.h"
 
 #include <QObject>
 #include <QWidget>
+#include <QVector>
+#include <QHash>
+#include <QColor>
+#include <QRect>
+#include <QPainter>
+#include <QStaticText>
+#include <QFont>
+
+#define CCELLARRAY_MAX_STATIC_TEXT	2048		/* start over when this many static text runs are cached */
 
 class CScreen;
 class CCellArray : public QObject
@@ -43,13 +55,36 @@ class CCellArray : public QObject
 		inline QRect&		rect()							{return mRect;}
 		inline int			cols()							{return mCols;}
 		inline int			rows()							{return mRows;}
-		QList<CCharCell>	cells()							{return mCells;}
-		inline const CCharCell&	cell(int col,int row)		{return mCells.at(indexOf(col,row));}
-		inline int			indexOf(int col,int row)		{return (row*cols())+col;}
-		inline bool			isValidCell(int col,int row)	{return indexOf(col,row) < count();}
+		inline CCharCell&	cell(int col,int row)			{return mCells.data()[indexOf(col,row)];}
+		inline CCharCell*	line(int row)					{return mCells.data()+indexOf(0,row);}	/** the first cell of a row */
+		inline int			indexOf(int col,int row)		{return (mRowMap.at(row)*cols())+col;}
+		inline bool			isValidCell(int col,int row)	{return col >= 0 && row >= 0 && col < cols() && row < rows();}
 		inline int			count()							{return mCells.count();}
+		inline int			cellWidth()						{return mCellWidth;}
+		inline int			cellHeight()					{return mCellHeight;}
+		inline CGlyphCache&	glyphs()						{return mGlyphs;}
+		inline CStyleTable&	styles()						{return mStyles;}
+		inline bool			staticText()					{return mUseStaticText;}
+		inline CScrollback*	scrollback()					{return mScrollback;}
+		inline int			viewOffset()					{return mViewOffset;}		/** history lines shown above the grid, 0 shows the live grid */
+		inline int			historyLines()					{return ( mScrollback != NULL && !mAlternate ) ? mScrollback->lines() : 0;}
+		inline bool			alternate()						{return mAlternate;}			/** the alternate grid is shown */
+		QRect				cellRect(int col,int row);					/** pixel rectangle of a cell */
+		QRect				spanRect(int col,int row,int count);		/** pixel rectangle of count cells of a row */
+		QRect				rowsRect(int row,int count);				/** pixel rectangle of count whole rows */
+		inline bool			rowBlinks(int row)				{return mBlinkRows.at(mRowMap.at(row));}	/** row may hold blinking cells */
+		inline int			blinkRowCount()					{return mBlinkRowCount;}
+		void				markBlink(int row);							/** note that a row holds blinking cells */
+		void				unmarkBlink(int row);						/** note that a row holds no blinking cells */
+		void				fillSpan(int col,int row,int count,const CCharCell& blank);	/** set count cells of a row to blank */
+		void				fillRows(int row,int count,const CCharCell& blank);			/** set count whole rows to blank */
+		void				fillRect(const QRect& r,const CCharCell& blank);			/** set a rectangle of cells to blank */
 		void				selectCells(QRect r);
 		void				deselectCells();
+		void				markStyles(QBitArray& used);				/** set the bit of every style id still in use */
+
+		QColor				foregroundColor(quint16 style);				/** the foreground of a style id, defaults resolved */
+		QColor				backgroundColor(quint16 style);				/** the background of a style id, defaults resolved */
 
 	public slots:
 		void				setScreen(CScreen* screen);
@@ -58,17 +93,52 @@ class CCellArray : public QObject
 		void				setCols(int cols);
 		void				setRows(int rows);
 		void				draw(QPainter& painter, const QRect& rect);
-		void				draw(const QRect& rect);
+		void				setStaticText(bool b);							/** draw runs with QStaticText instead of the glyph atlas */
+		void				setScrollback(CScrollback* scrollback);			/** where lines scrolled off the top go, NULL for none */
+		void				setViewOffset(int lines);
+		void				setAlternate(bool on, bool clear=false);		/** swap in the alternate grid or back, clear blanks the alternate grid */
+		void				setHighlight(int line, int col, int count);		/** mark count cells of a line, lines count from the oldest in history, -1 for none */
 		void				scrollGrid(CCellArray::ScrollMode mode, int x, int y, int width, int height);
 		void				sync();
 
 	private:
+		void				resize(int cols,int rows);
+		void				resizeGrid(int cols,int rows);
+		void				swapGrids();
+		void				clearGrid();
+		void				drawRun(QPainter& painter, const QPoint& pt, const CCharCell* cells, int count, const QColor& fg);
+		void				setupTextFonts();
+		const CCharCell*	viewLine(int row);
+
 		CScreen*			mScreen;
 		QRect				mRect;
 		int					mCols;
 		int					mRows;
-		QList<CCharCell>	mCells;
-		bool				mSyncBusy;
+		int					mCellWidth;
+		int					mCellHeight;
+		QVector<CCharCell>	mCells;							/** row-major, cols()*rows() cells */
+		QVector<int>		mRowMap;						/** storage row of each screen row */
+		QVector<bool>		mBlinkRows;						/** by storage row, set when the row may hold blinking cells */
+		int					mBlinkRowCount;					/** rows set in mBlinkRows */
+		bool				mAlternate;						/** the alternate grid is in mCells, the primary one in mOtherCells */
+		QVector<CCharCell>	mOtherCells;					/** the grid not shown, with its row map and blink index */
+		QVector<int>		mOtherRowMap;
+		QVector<bool>		mOtherBlinkRows;
+		int					mOtherBlinkRowCount;
+		CStyleTable			mStyles;						/** renditions of the cells by style id */
+		CGlyphCache			mGlyphs;						/** rasterized glyphs for the cell size */
+		bool				mUseStaticText;					/** draw runs with QStaticText */
+		int					mTextCellWidth;					/** cell size the text fonts were built for */
+		int					mTextCellHeight;
+		QFont				mTextFont;						/** cell high, letter spaced to the cell width */
+		QFont				mBoldTextFont;
+		QHash<QString,QStaticText> mStaticText;				/** prepared runs by bold flag and text */
+		CScrollback*		mScrollback;					/** history, NULL when lines scrolled off are dropped */
+		int					mViewOffset;					/** history lines shown above the grid */
+		QVector<CCharCell>	mViewRow;						/** a history line padded to the width of the grid */
+		int					mHighlightLine;					/** line of the marked cells, -1 for none */
+		int					mHighlightCol;
+		int					mHighlightCount;
 };
 
 #endif // CCELLARRAY_H
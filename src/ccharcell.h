@@ -20,101 +20,45 @@
 #define CCHARCELL_H
 
 #include <QChar>
-#include <QString>
-#include <QColor>
-#include <QObject>
-#include <QRect>
-#include <QWidget>
-#include <QPainter>
-
-#define DEFAULTCURSORSTYLE BlockInvert
-
-class CScreen;
-class CCellArray;
-class CCharCell : public QObject
+#include <QtGlobal>
+
+/**
+ * @brief One character cell of the screen grid.
+ * @brief A plain 8 byte value, cells are stored by value in a contiguous row-major buffer
+ * @brief owned by CCellArray and copied with memcpy. The colors and attributes are interned in
+ * @brief the style table of the cell array and referenced by id, style 0 is the screen default.
+ */
+class CCharCell
 {
-	Q_OBJECT
 	public:
 
-		typedef enum
-		{
-			Underline,
-			BlockOutline,
-			BlockInvert
-		} CursorStyle;
-
-		static const  unsigned int attrSelect    =   0x0001;   // selected.
-		static const  unsigned int attrBlink     =   0x0002;   // blink.
-		static const  unsigned int attrBold      =   0x0004;   // bold.
-		static const  unsigned int attrReverse   =   0x0008;   // reverse.
-		static const  unsigned int attrUnderline =   0x0010;   // underline.
-		static const  unsigned int attrCursor    =   0x0020;   // cursor
-
-		CCharCell(CCellArray* cellArray);
-		CCharCell(const CCharCell & _other) : QObject() {copy((CCharCell*)(&_other));}
-		virtual ~CCharCell();
-
-		inline CCellArray*	container()				{return mCellArray;}
-		inline CursorStyle	cursorStyle()			{return mCursorStyle;}
-		inline bool			cursor()				{return ( mAttributes & attrCursor );}
-		inline bool			blink()					{return ( mAttributes & attrBlink );}
-		inline bool			select()				{return ( mAttributes & attrSelect );}
-		inline bool			bold()					{return ( mAttributes & attrBold );}
-		inline bool			reverse()				{return ( mAttributes & attrReverse );}
-		inline bool			underline()				{return ( mAttributes & attrUnderline );}
-		inline unsigned short attributes()			{return mAttributes;}
-		inline QChar		character()				{return mCharacter;}
-		inline QRect		rect()					{return mRect;}
-
-		inline QColor&		backgroundColor()		{return reverse()?mForegroundColor:mBackgroundColor;}
-		inline QColor&		foregroundColor()		{return reverse()?mBackgroundColor:mForegroundColor;}
+		static const  quint16 flagSelect    =   0x0001;   // selected.
 
-		CScreen*			screen();
+		CCharCell() : mCodepoint(' '), mStyle(0), mFlags(0) {}
+		CCharCell(quint32 codepoint, quint16 style) : mCodepoint(codepoint), mStyle(style), mFlags(0) {}
 
-		inline void			setContainer(CCellArray* container) {mCellArray=container;}
-		void				setCursor(bool _b,CursorStyle cs=DEFAULTCURSORSTYLE);
-		void				setCursorStyle(CursorStyle cs);
-		void				setBlink(bool b);
-		void				setSelect(bool b);
-		void				setBold(bool b);
-		void				setReverse(bool b);
-		void				setUnderline(bool b);
-		void				setAttributes(unsigned short a);
-		void				setCharacter(QChar c);
-		void				setForegroundColor(QColor c);
-		void				setBackgroundColor(QColor c);
-		void				setRect(QRect r);
+		inline bool			select() const			{return ( mFlags & flagSelect );}
+		inline quint16		flags() const			{return mFlags;}
+		inline quint16		style() const			{return mStyle;}
+		inline quint32		rendition() const		{return mStyle | ((quint32)mFlags << 16);}	/** style and flags, equal for cells drawn alike */
+		inline quint32		codepoint() const		{return mCodepoint;}
+		inline QChar		character() const		{return QChar((ushort)mCodepoint);}
 
-		void				clear();						/** reset properties to default values */
-		void				copy(CCharCell* other);			/** copy a cell */
-		void				copy(CCharCell& other);			/** copy a cell */
-		CCharCell & operator=(const CCharCell & other);		/** copy operator */
+		inline void			setSelect(bool b)		{b ? mFlags |= flagSelect : mFlags &= ~flagSelect;}
+		inline void			setStyle(quint16 s)		{mStyle=s;}
+		inline void			setCodepoint(quint32 c)	{mCodepoint=c;}
+		inline void			setCharacter(QChar c)	{mCodepoint=c.unicode();}
 
-	public slots:
-		void				update();
-		void				draw();
-		void				draw(QPainter& painter);
-
-	private slots:
-		void drawCursorBegin(QPainter& paint);
-		void drawCursorEnd(QPainter& paint);
-
-	protected:
-		void timerEvent(QTimerEvent *e);
+		inline void			clear()					{*this=CCharCell();}	/** reset to a blank in the default style */
 
 	private:
-		CCellArray*		mCellArray;							/** the container */
-		QRect			mRect;								/** the position rectangle */
-		unsigned short	mAttributes;						/** character attributes */
-		QChar			mCharacter;							/** character property */
-		QColor			mForegroundColor;					/** forground color */
-		QColor			mBackgroundColor;					/** background color */
-		int				mCursorTimer;
-		int				mBlinkTimer;
-		bool			mCursorState;
-		bool			mBlinkState;
-		CursorStyle		mCursorStyle;
+		quint32				mCodepoint;							/** unicode code point */
+		quint16				mStyle;								/** id in the cell array style table */
+		quint16				mFlags;								/** view state, not part of the rendition */
 };
 
-#endif
+Q_DECLARE_TYPEINFO(CCharCell, Q_MOVABLE_TYPE);	/* not primitive, a new cell is a blank and not zeros */
 
+static_assert(sizeof(CCharCell) == 8, "CCharCell must stay packed");
+
+#endif
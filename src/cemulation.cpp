@@ -42,6 +42,11 @@ CEmulation::~CEmulation()
 /** reset to initial state */
 void CEmulation::doReset()
 {
+	setAlternateScreen(false);
+	setReverseVideo(false);
+	screen()->resetPalette();
+	screen()->setStyleId(0);
+	screen()->clear();
 }
 
 /** move cursor to x,y */
@@ -107,12 +112,7 @@ void CEmulation::doClearEOL(ClearLineMode mode)
 		 }
 		 break;
 		case ClearLineAOL: // full line
-		{
-			QPoint save = screen()->cursorPos();
-			screen()->setCursorPos(0,save.y());
-			screen()->clearEOL();
-			screen()->setCursorPos(save);
-		}
+			screen()->fillSpan(0,screen()->cursorPos().y(),screen()->cols(),screen()->eraseStyle());
 		break;
 	}
 }
@@ -139,6 +139,12 @@ void CEmulation::doDeleteCharacters(int num)
 	screen()->delChars(num);
 }
 
+/** erase character(s) in line */
+void CEmulation::doEraseCharacters(int num)
+{
+	screen()->eraseChars(num);
+}
+
 /** insert lines */
 void CEmulation::doInsertLines(int num)
 {
@@ -161,18 +167,7 @@ void CEmulation::doRestoreCursorPos()
 /** ring a visual bell */
 void CEmulation::doVisualBell()
 {
-	for( int flash=0; flash<2; flash++ )
-	{
-		for( int y=0; y < screen()->rows(); y++ )
-		{
-			for (int x=0; x < screen()->cols();x++ )
-			{
-				CCharCell& c = screen()->cell(x,y);
-				c.setReverse( !c.reverse() );
-			}
-		}
-		screen()->repaint();
-	}
+	screen()->visualBell();
 }
 
 /** ring bell or perform visual bell */
@@ -258,16 +253,56 @@ void CEmulation::doChar(unsigned char ch)
 	if ( autoInsert() )
 	{
 		int y = screen()->cursorPos().y();
-		for( int x=screen()->rows()-1; x > screen()->cursorPos().x(); x-- )
+		for( int x=screen()->cols()-1; x > screen()->cursorPos().x(); x-- )
 		{
-			screen()->cell(x,y).copy( screen()->cell(x-1,y) );
+			screen()->cell(x,y) = screen()->cell(x-1,y);
 		}
 		screen()->cell( screen()->cursorPos() ).clear();
+		screen()->invalidateSpan(screen()->cursorPos().x(),y,screen()->cols()-screen()->cursorPos().x());
 	}
 	screen()->putchar(ch,screen()->cursorPos());
 	doAdvanceCursor();
 }
 
+/** write a run of printable characters, wrapping a line at a time */
+void CEmulation::doString(const char* s, int len)
+{
+	if ( autoInsert() )
+	{
+		for( int n=0; n < len; n++ )
+		{
+			doChar((unsigned char)s[n]);
+		}
+		return;
+	}
+	while ( len > 0 )
+	{
+		QPoint pos = screen()->cursorPos();
+		if ( !autoWrap() && pos.x() >= screen()->cols()-1 )
+		{
+			/* pinned at the right margin, only the last character survives */
+			s += len-1;
+			len = 1;
+		}
+		int count = screen()->putRun(s,len);
+		s += count;
+		len -= count;
+		screen()->setCursorPos(pos.x()+count-1,pos.y());
+		doAdvanceCursor();
+	}
+}
+
+/** receive a chunk of characters, the screen is repainted once at the end of the chunk */
+void CEmulation::receiveBytes(const char* data, int len)
+{
+	screen()->beginUpdate();
+	for( int n=0; n < len; n++ )
+	{
+		receiveChar((unsigned char)data[n]);
+	}
+	screen()->endUpdate();
+}
+
 void CEmulation::setGrid(int cols,int rows)
 {
 	screen()->setGrid(cols,rows);
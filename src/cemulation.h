@@ -62,6 +62,7 @@ class CEmulation : public QObject
 		inline int			cols()								{return screen()->cols();}
 		inline int			rows()								{return screen()->rows();}
 		inline bool			jumpScroll()						{return mJumpScroll;}
+		inline bool			alternateScreen()					{return screen()->alternateScreen();}
 		inline bool			reverseVideo()						{return mReverseVideo;}
 		inline bool			relativeCoordinates()				{return mRelativeCoordinates;}
 
@@ -76,6 +77,7 @@ class CEmulation : public QObject
 
 		virtual void		doClearEOL(ClearLineMode mode);			/** clear to EOL from cursor position */
 		virtual void		doDeleteCharacters(int num);			/** delete characters in line */
+		virtual void		doEraseCharacters(int num);				/** blank characters from the cursor */
 		virtual void		doInsertLines(int num);					/** insert lines */
 		virtual void		doNewLine();							/** new line */
 		virtual void		doReverseNewLine();						/** reverse new line */
@@ -91,6 +93,7 @@ class CEmulation : public QObject
 
 		virtual void		doAdvanceCursor();						/** advance cursor and wrap if nessesary */
 		virtual void		doChar(unsigned char ch);				/** write a character to the screen */
+		virtual void		doString(const char* s, int len);		/** write a run of printable characters to the screen */
 		
 	signals:
 		void				sendAsciiChar(const char ch);
@@ -100,19 +103,21 @@ class CEmulation : public QObject
 
 		virtual void		keyPressEvent(QKeyEvent* e)=0;			/** key press input. process and transmit the char. */
 		virtual void		receiveChar(unsigned char _ch)=0;		/** received and process an incoming character */
+		virtual void		receiveBytes(const char* data, int len);	/** receive and process a chunk of incoming characters */
 
 		virtual void		setVisualBell(bool b)				{mVisualBell=b;}
 		virtual void		setLocalEcho(bool b)				{mLocalEcho=b;}
 		virtual void		setAutoWrap(bool b)					{mAutoWrap=b;}
 		virtual void		setAutoNewLine(bool b)				{mAutoNewLine=b;}
 		virtual void		setAutoInsert(bool b)				{mAutoInsert=b;}
-		virtual void		setCursorOn(bool b)					{mCursorOn=b;}
+		virtual void		setCursorOn(bool b)					{mCursorOn=b; screen()->setCursorVisible(b);}
 		virtual void		setKeyboardLock(bool b)				{mKeyboardLock=b;}
 		virtual void		setCols(int cols)					{screen()->setCols(cols);}
 		virtual void		setRows(int rows)					{screen()->setRows(rows);}
 		virtual void		setGrid(int cols,int rows);
-		virtual void		setJumpScroll(bool b)				{mJumpScroll=b;}
-		virtual void		setReverseVideo(bool b)				{mReverseVideo=b;}
+		virtual void		setJumpScroll(bool b)				{mJumpScroll=b; screen()->setJumpScroll(b);}
+		virtual void		setAlternateScreen(bool b, bool clear=false)	{screen()->setAlternateScreen(b,clear);}
+		virtual void		setReverseVideo(bool b)				{mReverseVideo=b; screen()->setReverseScreen(b);}
 		virtual void		setRelativeCoordinates(bool b)		{mRelativeCoordinates=b;}
 
 	private:
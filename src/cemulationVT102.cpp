@@ -16,6 +16,7 @@
 *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
 **************************************************************************/
 #include "cemulationVT102.h"
+#include "csimd.h"
 #include <QString>
 
 #define ASCII_ENQ   0x05
@@ -25,7 +26,10 @@
 #define ASCII_CSI   0x9B
 #define ASCII_BEL   0x07
 #define ASCII_BS    0x08
+#define ASCII_HT    0x09
 #define ASCII_LF    0x0A
+#define ASCII_VT    0x0B
+#define ASCII_FF    0x0C
 #define ASCII_CR    0x0D
 #define ASCII_ESC   0x1B
 
@@ -33,13 +37,393 @@
 
 #define inherited CEmulation
 
+/** byte classes, the columns of the transition table */
+enum
+{
+	ClassControl,		/* C0 controls not listed below */
+	ClassBell,			/* BEL, also terminates OSC */
+	ClassCancel,		/* CAN SUB */
+	ClassEscape,		/* ESC */
+	ClassIntermediate,	/* 0x20..0x2F */
+	ClassDigit,			/* 0..9 */
+	ClassColon,			/* : sub-parameter separator */
+	ClassSemicolon,		/* ; parameter separator */
+	ClassPrivate,		/* < = > ? */
+	ClassFinal,			/* 0x40..0x7E not listed below */
+	ClassCsi,			/* [ */
+	ClassOsc,			/* ] */
+	ClassDcs,			/* P */
+	ClassSosPmApc,		/* X ^ _ */
+	ClassDelete,		/* DEL */
+	ClassC1Csi,			/* 8 bit CSI */
+	ClassHigh,			/* 0x80..0xFF not listed above */
+	ClassCount
+};
+
+#define C0	ClassControl
+#define BL	ClassBell
+#define CN	ClassCancel
+#define ES	ClassEscape
+#define IN	ClassIntermediate
+#define DG	ClassDigit
+#define CL	ClassColon
+#define SC	ClassSemicolon
+#define PV	ClassPrivate
+#define FN	ClassFinal
+#define LB	ClassCsi
+#define RB	ClassOsc
+#define DC	ClassDcs
+#define SP	ClassSosPmApc
+#define DL	ClassDelete
+#define C1	ClassC1Csi
+#define HI	ClassHigh
+
+static constexpr unsigned char sByteClass[256] =
+{
+/*        0   1   2   3   4   5   6   7   8   9   A   B   C   D   E   F */
+/* 0x */ C0, C0, C0, C0, C0, C0, C0, BL, C0, C0, C0, C0, C0, C0, C0, C0,
+/* 1x */ C0, C0, C0, C0, C0, C0, C0, C0, CN, C0, CN, ES, C0, C0, C0, C0,
+/* 2x */ IN, IN, IN, IN, IN, IN, IN, IN, IN, IN, IN, IN, IN, IN, IN, IN,
+/* 3x */ DG, DG, DG, DG, DG, DG, DG, DG, DG, DG, CL, SC, PV, PV, PV, PV,
+/* 4x */ FN, FN, FN, FN, FN, FN, FN, FN, FN, FN, FN, FN, FN, FN, FN, FN,
+/* 5x */ DC, FN, FN, FN, FN, FN, FN, FN, SP, FN, FN, LB, FN, RB, SP, SP,
+/* 6x */ FN, FN, FN, FN, FN, FN, FN, FN, FN, FN, FN, FN, FN, FN, FN, FN,
+/* 7x */ FN, FN, FN, FN, FN, FN, FN, FN, FN, FN, FN, FN, FN, FN, FN, DL,
+/* 8x */ HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI,
+/* 9x */ HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, C1, HI, HI, HI, HI,
+/* Ax */ HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI,
+/* Bx */ HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI,
+/* Cx */ HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI,
+/* Dx */ HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI,
+/* Ex */ HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI,
+/* Fx */ HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI, HI
+};
+
+#undef C0
+#undef BL
+#undef CN
+#undef ES
+#undef IN
+#undef DG
+#undef CL
+#undef SC
+#undef PV
+#undef FN
+#undef LB
+#undef RB
+#undef DC
+#undef SP
+#undef DL
+#undef C1
+#undef HI
+
+/* a transition is the next state in the high nibble and the action in the low nibble */
+#define TR(action,state)	(unsigned char)((CEmulationVT102::state<<4)|CEmulationVT102::action)
+#define NONE(state)			TR(ActionNone,state)
+
+static constexpr unsigned char sTransition[CEmulationVT102::StateCount][ClassCount] =
+{
+	/* StateGround */
+	{
+		TR(ActionExecute,StateGround),			/* control */
+		TR(ActionExecute,StateGround),			/* BEL */
+		TR(ActionExecute,StateGround),			/* CAN SUB */
+		TR(ActionClear,StateEscape),			/* ESC */
+		TR(ActionPrint,StateGround),			/* intermediate */
+		TR(ActionPrint,StateGround),			/* digit */
+		TR(ActionPrint,StateGround),			/* : */
+		TR(ActionPrint,StateGround),			/* ; */
+		TR(ActionPrint,StateGround),			/* private */
+		TR(ActionPrint,StateGround),			/* final */
+		TR(ActionPrint,StateGround),			/* [ */
+		TR(ActionPrint,StateGround),			/* ] */
+		TR(ActionPrint,StateGround),			/* P */
+		TR(ActionPrint,StateGround),			/* X ^ _ */
+		NONE(StateGround),						/* DEL */
+		TR(ActionClear,StateCsiEntry),			/* 8 bit CSI */
+		TR(ActionPrint,StateGround)				/* high */
+	},
+	/* StateEscape */
+	{
+		TR(ActionExecute,StateEscape),
+		TR(ActionExecute,StateEscape),
+		NONE(StateGround),
+		TR(ActionClear,StateEscape),
+		TR(ActionCollect,StateEscapeIntermediate),
+		TR(ActionEscDispatch,StateGround),
+		TR(ActionEscDispatch,StateGround),
+		TR(ActionEscDispatch,StateGround),
+		TR(ActionEscDispatch,StateGround),
+		TR(ActionEscDispatch,StateGround),
+		TR(ActionClear,StateCsiEntry),
+		TR(ActionOscStart,StateOscString),
+		TR(ActionClear,StateDcsEntry),
+		NONE(StateSosPmApcString),
+		NONE(StateEscape),
+		TR(ActionClear,StateCsiEntry),
+		NONE(StateGround)
+	},
+	/* StateEscapeIntermediate */
+	{
+		TR(ActionExecute,StateEscapeIntermediate),
+		TR(ActionExecute,StateEscapeIntermediate),
+		NONE(StateGround),
+		TR(ActionClear,StateEscape),
+		TR(ActionCollect,StateEscapeIntermediate),
+		TR(ActionEscDispatch,StateGround),
+		TR(ActionEscDispatch,StateGround),
+		TR(ActionEscDispatch,StateGround),
+		TR(ActionEscDispatch,StateGround),
+		TR(ActionEscDispatch,StateGround),
+		TR(ActionEscDispatch,StateGround),
+		TR(ActionEscDispatch,StateGround),
+		TR(ActionEscDispatch,StateGround),
+		TR(ActionEscDispatch,StateGround),
+		NONE(StateEscapeIntermediate),
+		TR(ActionClear,StateCsiEntry),
+		NONE(StateGround)
+	},
+	/* StateCsiEntry */
+	{
+		TR(ActionExecute,StateCsiEntry),
+		TR(ActionExecute,StateCsiEntry),
+		NONE(StateGround),
+		TR(ActionClear,StateEscape),
+		TR(ActionCollect,StateCsiIntermediate),
+		TR(ActionParam,StateCsiParam),
+		TR(ActionParam,StateCsiParam),
+		TR(ActionParam,StateCsiParam),
+		TR(ActionCollect,StateCsiParam),
+		TR(ActionCsiDispatch,StateGround),
+		TR(ActionCsiDispatch,StateGround),
+		TR(ActionCsiDispatch,StateGround),
+		TR(ActionCsiDispatch,StateGround),
+		TR(ActionCsiDispatch,StateGround),
+		NONE(StateCsiEntry),
+		TR(ActionClear,StateCsiEntry),
+		NONE(StateCsiIgnore)
+	},
+	/* StateCsiParam */
+	{
+		TR(ActionExecute,StateCsiParam),
+		TR(ActionExecute,StateCsiParam),
+		NONE(StateGround),
+		TR(ActionClear,StateEscape),
+		TR(ActionCollect,StateCsiIntermediate),
+		TR(ActionParam,StateCsiParam),
+		TR(ActionParam,StateCsiParam),
+		TR(ActionParam,StateCsiParam),
+		NONE(StateCsiIgnore),
+		TR(ActionCsiDispatch,StateGround),
+		TR(ActionCsiDispatch,StateGround),
+		TR(ActionCsiDispatch,StateGround),
+		TR(ActionCsiDispatch,StateGround),
+		TR(ActionCsiDispatch,StateGround),
+		NONE(StateCsiParam),
+		TR(ActionClear,StateCsiEntry),
+		NONE(StateCsiIgnore)
+	},
+	/* StateCsiIntermediate */
+	{
+		TR(ActionExecute,StateCsiIntermediate),
+		TR(ActionExecute,StateCsiIntermediate),
+		NONE(StateGround),
+		TR(ActionClear,StateEscape),
+		TR(ActionCollect,StateCsiIntermediate),
+		NONE(StateCsiIgnore),
+		NONE(StateCsiIgnore),
+		NONE(StateCsiIgnore),
+		NONE(StateCsiIgnore),
+		TR(ActionCsiDispatch,StateGround),
+		TR(ActionCsiDispatch,StateGround),
+		TR(ActionCsiDispatch,StateGround),
+		TR(ActionCsiDispatch,StateGround),
+		TR(ActionCsiDispatch,StateGround),
+		NONE(StateCsiIntermediate),
+		TR(ActionClear,StateCsiEntry),
+		NONE(StateCsiIgnore)
+	},
+	/* StateCsiIgnore */
+	{
+		TR(ActionExecute,StateCsiIgnore),
+		TR(ActionExecute,StateCsiIgnore),
+		NONE(StateGround),
+		TR(ActionClear,StateEscape),
+		NONE(StateCsiIgnore),
+		NONE(StateCsiIgnore),
+		NONE(StateCsiIgnore),
+		NONE(StateCsiIgnore),
+		NONE(StateCsiIgnore),
+		NONE(StateGround),
+		NONE(StateGround),
+		NONE(StateGround),
+		NONE(StateGround),
+		NONE(StateGround),
+		NONE(StateCsiIgnore),
+		TR(ActionClear,StateCsiEntry),
+		NONE(StateCsiIgnore)
+	},
+	/* StateOscString */
+	{
+		NONE(StateOscString),
+		NONE(StateGround),
+		NONE(StateGround),
+		TR(ActionClear,StateEscape),
+		TR(ActionOscPut,StateOscString),
+		TR(ActionOscPut,StateOscString),
+		TR(ActionOscPut,StateOscString),
+		TR(ActionOscPut,StateOscString),
+		TR(ActionOscPut,StateOscString),
+		TR(ActionOscPut,StateOscString),
+		TR(ActionOscPut,StateOscString),
+		TR(ActionOscPut,StateOscString),
+		TR(ActionOscPut,StateOscString),
+		TR(ActionOscPut,StateOscString),
+		NONE(StateOscString),
+		TR(ActionOscPut,StateOscString),
+		TR(ActionOscPut,StateOscString)
+	},
+	/* StateDcsEntry */
+	{
+		NONE(StateDcsEntry),
+		NONE(StateDcsEntry),
+		NONE(StateGround),
+		TR(ActionClear,StateEscape),
+		TR(ActionCollect,StateDcsIntermediate),
+		TR(ActionParam,StateDcsParam),
+		TR(ActionParam,StateDcsParam),
+		TR(ActionParam,StateDcsParam),
+		TR(ActionCollect,StateDcsParam),
+		NONE(StateDcsPassthrough),
+		NONE(StateDcsPassthrough),
+		NONE(StateDcsPassthrough),
+		NONE(StateDcsPassthrough),
+		NONE(StateDcsPassthrough),
+		NONE(StateDcsEntry),
+		TR(ActionClear,StateCsiEntry),
+		NONE(StateDcsIgnore)
+	},
+	/* StateDcsParam */
+	{
+		NONE(StateDcsParam),
+		NONE(StateDcsParam),
+		NONE(StateGround),
+		TR(ActionClear,StateEscape),
+		TR(ActionCollect,StateDcsIntermediate),
+		TR(ActionParam,StateDcsParam),
+		TR(ActionParam,StateDcsParam),
+		TR(ActionParam,StateDcsParam),
+		NONE(StateDcsIgnore),
+		NONE(StateDcsPassthrough),
+		NONE(StateDcsPassthrough),
+		NONE(StateDcsPassthrough),
+		NONE(StateDcsPassthrough),
+		NONE(StateDcsPassthrough),
+		NONE(StateDcsParam),
+		TR(ActionClear,StateCsiEntry),
+		NONE(StateDcsIgnore)
+	},
+	/* StateDcsIntermediate */
+	{
+		NONE(StateDcsIntermediate),
+		NONE(StateDcsIntermediate),
+		NONE(StateGround),
+		TR(ActionClear,StateEscape),
+		TR(ActionCollect,StateDcsIntermediate),
+		NONE(StateDcsIgnore),
+		NONE(StateDcsIgnore),
+		NONE(StateDcsIgnore),
+		NONE(StateDcsIgnore),
+		NONE(StateDcsPassthrough),
+		NONE(StateDcsPassthrough),
+		NONE(StateDcsPassthrough),
+		NONE(StateDcsPassthrough),
+		NONE(StateDcsPassthrough),
+		NONE(StateDcsIntermediate),
+		TR(ActionClear,StateCsiEntry),
+		NONE(StateDcsIgnore)
+	},
+	/* StateDcsPassthrough - device control strings are swallowed */
+	{
+		NONE(StateDcsPassthrough),
+		NONE(StateDcsPassthrough),
+		NONE(StateGround),
+		TR(ActionClear,StateEscape),
+		NONE(StateDcsPassthrough),
+		NONE(StateDcsPassthrough),
+		NONE(StateDcsPassthrough),
+		NONE(StateDcsPassthrough),
+		NONE(StateDcsPassthrough),
+		NONE(StateDcsPassthrough),
+		NONE(StateDcsPassthrough),
+		NONE(StateDcsPassthrough),
+		NONE(StateDcsPassthrough),
+		NONE(StateDcsPassthrough),
+		NONE(StateDcsPassthrough),
+		NONE(StateDcsPassthrough),
+		NONE(StateDcsPassthrough)
+	},
+	/* StateDcsIgnore */
+	{
+		NONE(StateDcsIgnore),
+		NONE(StateDcsIgnore),
+		NONE(StateGround),
+		TR(ActionClear,StateEscape),
+		NONE(StateDcsIgnore),
+		NONE(StateDcsIgnore),
+		NONE(StateDcsIgnore),
+		NONE(StateDcsIgnore),
+		NONE(StateDcsIgnore),
+		NONE(StateDcsIgnore),
+		NONE(StateDcsIgnore),
+		NONE(StateDcsIgnore),
+		NONE(StateDcsIgnore),
+		NONE(StateDcsIgnore),
+		NONE(StateDcsIgnore),
+		NONE(StateDcsIgnore),
+		NONE(StateDcsIgnore)
+	},
+	/* StateSosPmApcString */
+	{
+		NONE(StateSosPmApcString),
+		NONE(StateSosPmApcString),
+		NONE(StateGround),
+		TR(ActionClear,StateEscape),
+		NONE(StateSosPmApcString),
+		NONE(StateSosPmApcString),
+		NONE(StateSosPmApcString),
+		NONE(StateSosPmApcString),
+		NONE(StateSosPmApcString),
+		NONE(StateSosPmApcString),
+		NONE(StateSosPmApcString),
+		NONE(StateSosPmApcString),
+		NONE(StateSosPmApcString),
+		NONE(StateSosPmApcString),
+		NONE(StateSosPmApcString),
+		NONE(StateSosPmApcString),
+		NONE(StateSosPmApcString)
+	}
+};
+
+#undef NONE
+#undef TR
+
 CEmulationVT102::CEmulationVT102(CScreen* screen)
 : inherited(screen)
+, mState(StateGround)
+, mParamCount(0)
+, mSubParams(0)
+, mPrivate(0)
+, mIntermediate(0)
+, mOscLength(0)
+, mOscEscape(false)
+, mChar(0)
 , mApplicationCursorKeys(false)
 , mOriginMode(false)
 , mTopMargin(0)
 , mBottomMargin(0)
 {
+	mOscString[0]='\0';
 	QObject::connect(this,SIGNAL(codeNotHandled()),this,SLOT(doCodeNotHandled()));
 }
 
@@ -47,43 +431,22 @@ CEmulationVT102::~CEmulationVT102()
 {
 }
 
-/** Parse out the attributes from a control string */
-bool CEmulationVT102::attributes(QList<int>& attrs, QList<int>& extAttrs)
+/** Forget the parameters, private marker and intermediate of the last sequence */
+void CEmulationVT102::clearParams()
 {
-	QString num;
-	for( int n=0; n < mControlCode.length(); n++ )
-	{
-		if ( mControlCode.at(n) == '?' )
-		{
-			++n;
-			while(n < mControlCode.count() && isdigit(mControlCode.at(n)))
-			{
-				num = num + mControlCode.at(n);
-				++n;
-			}
-			extAttrs.append( num.toInt() );
-			num="";
-		}
-		else
-		{
-			while(n < mControlCode.count() && isdigit(mControlCode.at(n)))
-			{
-				num = num + mControlCode.at(n);
-				++n;
-			}
-			attrs.append( num.toInt() );
-			num="";
-		}
-	}
-	return ( attrs.count() > 0 || extAttrs.count() > 0 );
+	mParamCount=0;
+	mSubParams=0;
+	mPrivate=0;
+	mIntermediate=0;
 }
 
-
 /** reset to initial state */
 void CEmulationVT102::doReset()
 {
-	/* FIXME - do something here */
-	printf( "FIXME - doReset()\n" );
+	setOriginMode(false);
+	setApplicationCursorKeys(false);
+	setTopMargin(0);
+	setBottomMargin(rows());
 	inherited::doReset();
 }
 
@@ -91,18 +454,26 @@ void CEmulationVT102::doReset()
 void CEmulationVT102::doCodeNotHandled()
 {
 	putchar('<');
-	if ( mControlCode.length() > 1 )
+	if ( mPrivate )
 	{
-		for( int n=0; n < mControlCode.length(); n++ )
+		putchar(mPrivate);
+	}
+	for( int n=0; n < paramCount(); n++ )
+	{
+		if ( n )
 		{
-			putchar(mControlCode.data()[n]);
+			putchar(';');
+		}
+		if ( mParams[n] >= 0 )
+		{
+			printf("%d",mParams[n]);
 		}
-		putchar(mChar);
 	}
-	else
+	if ( mIntermediate )
 	{
-		putchar(mChar);
+		putchar(mIntermediate);
 	}
+	putchar(mChar);
 	putchar('>');
 	fflush(stdout);
 }
@@ -127,10 +498,7 @@ void CEmulationVT102::doCursorTo(int col, int row)
 /** cursor up one row */
 void CEmulationVT102::doCursorUp()
 {
-	QList<int> attrs;
-	QList<int> extAttrs;
-	attributes(attrs,extAttrs);
-	for( int y =  ( attrs.count() && attrs.at(0) > 0 ) ? attrs.at(0) : 1; y > 0; y-- )
+	for( int y = qMax(param(0,1),1); y > 0; y-- )
 	{
 		if ( !originMode() || (originMode() && cursorPos().y() > topMargin() ) )
 		{
@@ -142,10 +510,7 @@ void CEmulationVT102::doCursorUp()
 /** cursor down one row. */
 void CEmulationVT102::doCursorDown()
 {
-	QList<int> attrs;
-	QList<int> extAttrs;
-	attributes(attrs,extAttrs);
-	for( int y =  ( attrs.count() && attrs.at(0) > 0 ) ? attrs.at(0) : 1; y > 0; y-- )
+	for( int y = qMax(param(0,1),1); y > 0; y-- )
 	{
 		if ( !originMode() || (originMode() && cursorPos().y() < bottomMargin() ) )
 		{
@@ -157,10 +522,7 @@ void CEmulationVT102::doCursorDown()
 /** cursor left one column  */
 void CEmulationVT102::doCursorLeft()
 {
-	QList<int> attrs;
-	QList<int> extAttrs;
-	attributes(attrs,extAttrs);
-	for( int x =  ( attrs.count() && attrs.at(0) > 0 ) ? attrs.at(0) : 1; x > 0; x-- )
+	for( int x = qMax(param(0,1),1); x > 0; x-- )
 	{
 		inherited::doCursorLeft();
 	}
@@ -169,10 +531,7 @@ void CEmulationVT102::doCursorLeft()
 /** cursor right one column  */
 void CEmulationVT102::doCursorRight()
 {
-	QList<int> attrs;
-	QList<int> extAttrs;
-	attributes(attrs,extAttrs);
-	for( int x =  ( attrs.count() && attrs.at(0) > 0 ) ? attrs.at(0) : 1; x > 0; x-- )
+	for( int x = qMax(param(0,1),1); x > 0; x-- )
 	{
 		inherited::doCursorRight();
 	}
@@ -268,12 +627,21 @@ void CEmulationVT102::setGrid(int cols,int rows)
 /** do report */
 void CEmulationVT102::doReport()
 {
-	QList<int> attrs;
-	QList<int> extAttrs;
-	attributes(attrs,extAttrs);
-	if ( attrs.count() )
+	if ( privateMarker() == '?' )
 	{
-		switch(attrs.at(0))
+		switch(param(0,0))
+		{
+			case 15: /* Printer status report */
+				emit sendAsciiChar(ASCII_ESC); emit sendAsciiString("[?10n"); /* OK */
+				break;
+			default:
+				emit codeNotHandled();
+				break;
+		}
+	}
+	else if ( paramCount() )
+	{
+		switch(param(0,0))
 		{
 			case 5: /* Device Status Report */
 				emit sendAsciiChar(ASCII_ESC); emit sendAsciiString("[3n"); /* OK */
@@ -290,29 +658,12 @@ void CEmulationVT102::doReport()
 				break;
 		}
 	}
-	if ( extAttrs.count() )
-	{
-		switch(extAttrs.at(0))
-		{
-			case 15: /* Printer status report */
-				emit sendAsciiChar(ASCII_ESC); emit sendAsciiString("[?10n"); /* OK */
-				break;
-			default:
-				emit codeNotHandled();
-				break;
-		}
-	}
 }
 
 /** do device attributes */
 void CEmulationVT102::doDeviceAttributes()
 {
-	QList<int> attrs;
-	QList<int> extAttrs;
-	attributes(attrs,extAttrs);
-	if ( !attrs.count() )
-		attrs.append(0);
-	switch(attrs.at(0))
+	switch(param(0,0))
 	{
 		case 0: /* Device Attributes (terminal ID) */
 			emit sendAsciiChar(ASCII_ESC); emit sendAsciiString("[?6c"); /* VT102 */
@@ -323,33 +674,93 @@ void CEmulationVT102::doDeviceAttributes()
 	}
 }
 
+/**
+ * @brief Read the color following an SGR 38 or 48 at param n.
+ * @brief 5;n selects a palette index, 2;r;g;b a direct color. In the colon form the color is one
+ * @brief group of sub-params, 5:n or 2:cs:r:g:b where the colorspace cs is usually empty. 2:r:g:b
+ * @brief without the colorspace slot is accepted as well.
+ * @param n The param of the 38 or 48, left on the last param read.
+ * @return false when the color is malformed. The rest of a colon group is skipped, after a malformed
+ * @return semicolon form the rest of the params are.
+ */
+bool CEmulationVT102::extendedColor(int& n, QRgb& color)
+{
+	if ( subParam(n+1) )
+	{
+		int first = n+1;
+		int count = 0;
+		while ( subParam(first+count) )
+		{
+			++count;
+		}
+		n += count;
+		switch(param(first,-1))
+		{
+			case 5:
+				if ( count >= 2 )
+				{
+					color = CStyleTable::indexed(qBound(0,param(first+1,0),255));
+					return true;
+				}
+				break;
+			case 2:
+				if ( count >= 4 )
+				{
+					int r = ( count >= 5 ) ? first+2 : first+1;
+					color = qRgb(qBound(0,param(r,0),255),qBound(0,param(r+1,0),255),qBound(0,param(r+2,0),255));
+					return true;
+				}
+				break;
+		}
+		return false;
+	}
+	switch(param(n+1,-1))
+	{
+		case 5:
+			if ( n+2 < paramCount() )
+			{
+				color = CStyleTable::indexed(qBound(0,param(n+2,0),255));
+				n += 2;
+				return true;
+			}
+			break;
+		case 2:
+			if ( n+4 < paramCount() )
+			{
+				color = qRgb(qBound(0,param(n+2,0),255),qBound(0,param(n+3,0),255),qBound(0,param(n+4,0),255));
+				n += 4;
+				return true;
+			}
+			break;
+	}
+	n = paramCount();
+	return false;
+}
+
 /** do graphics attributes */
 void CEmulationVT102::doGraphics()
 {
-	QList<int> attrs;
-	QList<int> extAttrs;
-	attributes(attrs,extAttrs);
-	if (attrs.count() == 0 ) attrs.append(0);
-	for( int n=0; n < attrs.count(); n++ )
+	int count = paramCount() ? paramCount() : 1;
+	for( int n=0; n < count; n++ )
 	{
-		switch(attrs.at(n))
+		int p = param(n,0);
+		QRgb color;
+		if ( subParam(n) )
+		{
+			/* a sub-param the attribute before it did not use */
+			continue;
+		}
+		switch(p)
 		{
 			//    Text attributes
 			case 0:   //    All attributes off
-				{
-					screen()->setBackgroundColor(screen()->defaultBackgroundColor());
-					screen()->setForegroundColor(screen()->defaultForegroundColor());
-					screen()->setBlink(false);
-					screen()->setBold(false);
-					screen()->setReverse(false);
-					screen()->setUnderline(false);
-				}
+				screen()->setStyleId(0);
 				break;
 			case 1:   /* Bold on */
 				screen()->setBold(true);
 				break;
-			case 4:   /* Underscore on */
-				screen()->setUnderline(true);
+			case 4:   /* Underscore on, 4:0 is off and the other underline styles are drawn as one */
+				screen()->setUnderline( !( subParam(n+1) && param(n+1,0) == 0 ) );
 				break;
 			case 5:   /* Blink on */
 				screen()->setBlink(true);
@@ -359,49 +770,51 @@ void CEmulationVT102::doGraphics()
 				break;
 			case 8:   /* Concealed on */
 				break;
+			case 22:  /* Bold off */
+				screen()->setBold(false);
+				break;
+			case 24:  /* Underscore off */
+				screen()->setUnderline(false);
+				break;
+			case 25:  /* Blink off */
+				screen()->setBlink(false);
+				break;
+			case 27:  /* Reverse video off */
+				screen()->setReverse(false);
+				break;
 
-			/* Foreground colors */
-			case 30:  /* Black */
-				screen()->setForegroundColor(QColor(0,0,0));       break;
-			case 31:  /* Red */
-				screen()->setForegroundColor(QColor(255,0,0));     break;
-			case 32:  /* Green */
-				screen()->setForegroundColor(QColor(0,255,0));     break;
-			case 33:  /* Yellow */
-				screen()->setForegroundColor(QColor(240,240,10));  break;
-			case 34:  /* Blue */
-				screen()->setForegroundColor(QColor(0,0,255));     break;
-			case 35:  /* Magenta */
-				screen()->setForegroundColor(QColor(215,15,230));  break;
-			case 36:  /* Cyan */
-				screen()->setForegroundColor(QColor(10,240,230));  break;
-			case 37:  /* White */
-				screen()->setForegroundColor(QColor(255,255,255)); break;
-			case 38:
+			/* Foreground colors, black red green yellow blue magenta cyan white */
+			case 30: case 31: case 32: case 33: case 34: case 35: case 36: case 37:
+				screen()->setForeground(CStyleTable::indexed(p-30));
+				break;
+			case 90: case 91: case 92: case 93: case 94: case 95: case 96: case 97:
+				screen()->setForeground(CStyleTable::indexed((p-90)+8));
+				break;
+			case 38:  /* 256 color or direct foreground */
+				if ( extendedColor(n,color) )
+				{
+					screen()->setForeground(color);
+				}
+				break;
 			case 39:
-				screen()->setForegroundColor(screen()->defaultForegroundColor());
+				screen()->setForeground(CStyleTable::defaultColor);
 				break;
 
 			/* Background colors */
-			case 40:  /* Black */
-				screen()->setBackgroundColor(QColor(0,0,0));       break;
-			case 41:  /* Red */
-				screen()->setBackgroundColor(QColor(255,0,0));     break;
-			case 42:  /* Green */
-				screen()->setBackgroundColor(QColor(0,255,0));     break;
-			case 43:  /* Yellow */
-				screen()->setForegroundColor(QColor(240,240,10));  break;
-			case 44:  /* Blue */
-				screen()->setBackgroundColor(QColor(0,0,255));     break;
-			case 45:  /* Magenta */
-				screen()->setBackgroundColor(QColor(215,15,230));  break;
-			case 46:  /* Cyan */
-				screen()->setBackgroundColor(QColor(10,240,230));  break;
-			case 47:  /* White */
-				screen()->setBackgroundColor(QColor(255,255,255)); break;
-			case 48:
+			case 40: case 41: case 42: case 43: case 44: case 45: case 46: case 47:
+				screen()->setBackground(CStyleTable::indexed(p-40));
+				break;
+			case 100: case 101: case 102: case 103: case 104: case 105: case 106: case 107:
+				screen()->setBackground(CStyleTable::indexed((p-100)+8));
+				break;
+			case 48:  /* 256 color or direct background */
+				if ( extendedColor(n,color) )
+				{
+					screen()->setBackground(color);
+				}
+				break;
 			case 49:
-				screen()->setBackgroundColor(screen()->defaultBackgroundColor());
+				screen()->setBackground(CStyleTable::defaultColor);
 				break;
 
 			default:
@@ -428,7 +841,7 @@ Reset and set modes
    '?1'= Cursorkeys application (set); Cursorkeys normal (reset)
    '?2'= Ansi (set); VT52 (reset)
    '?3'= 132 char/row (set); 80 char/row (reset)
-   '?4'= Jump scroll (set); Smooth scroll (reset)
+   '?4'= Smooth scroll (set); Jump scroll (reset)
    '?5'= Reverse screen (set); Normal screen (reset)
    '?6'= Sets relative coordinates (set); Sets absolute coordinates (reset)
    '?7'= Auto wrap (set); Auto wrap off (reset)
@@ -436,63 +849,77 @@ Reset and set modes
   '?18'= Send FF to printer after print screen (set); No char after PS (reset)
   '?19'= Print screen prints full screen (set); PS prints scroll region (reset)
   '?25'= Cursor on (set); Cursor off (reset)
+  '?47'= Alternate screen (set); Normal screen (reset)
+'?1047'= Alternate screen (set); Clear and normal screen (reset)
+'?1049'= Save cursor and clear alternate screen (set); Normal screen and restore cursor (reset)
 */
 
 /** set terminal modes */
 void CEmulationVT102::doSetModes()
 {
-	QList<int> attrs;
-	QList<int> extAttrs;
-	attributes(attrs,extAttrs);
-	for( int n=0; n < attrs.count(); n++ )
+	for( int n=0; n < paramCount(); n++ )
 	{
-		switch(attrs.at(n))
+		if ( privateMarker() == '?' )
 		{
-		case 2:			/* keyboard lock */
-			setKeyboardLock(true);
-			break;
-		case 4:			/* insert mode */
-			setAutoInsert(true);
-			break;
-		case 12:		/* set echo mode */
-			setLocalEcho(true);
-			break;
-		case 20:		/* auto new line */
-			setAutoNewLine(true);
-			break;
-		default:
-			emit codeNotHandled();
-			break;
+			switch(param(n,0))
+			{
+			case 1:		/* application cursor keys */
+				setApplicationCursorKeys(true);
+				break;
+			case 3:		/* 132 columns */
+				setCols(132);
+				break;
+			case 4:		/* smooth scroll */
+				setJumpScroll(false);
+				break;
+			case 5:		/* reverse video */
+				setReverseVideo(true);
+				break;
+			case 6:		/* origin mode */
+				setOriginMode(true);
+				break;
+			case 7:		/* auto wrap */
+				setAutoWrap(true);
+				break;
+			case 25:	/* cursor on */
+				setCursorOn(true);
+				break;
+			case 47:	/* alternate screen */
+			case 1047:
+				setAlternateScreen(true);
+				break;
+			case 1049:	/* save cursor, clear alternate screen */
+				if ( !alternateScreen() )
+				{
+					doSaveCursorPos();
+					setAlternateScreen(true,true);
+				}
+				break;
+			default:
+				emit codeNotHandled();
+				break;
+			}
 		}
-	}
-	for( int n=0; n < extAttrs.count(); n++ )
-	{
-		switch(extAttrs.at(n))
+		else
 		{
-		case 1:		/* application cursor keys */
-			setApplicationCursorKeys(true);
-			break;
-		case 3:		/* 132 columns */
-			setCols(132);
-			break;
-		case 4:		/* jump scroll */
-			setJumpScroll(true);
-			break;
-		case 5:		/* reverse video */
-			setReverseVideo(true);
-			break;
-		case 6:		/* origin mode */
-			setOriginMode(true);
-			break;
-		case 7:		/* auto wrap */
-			setAutoWrap(true);
-			break;
-		case 25:	/* cursor on */
-			setCursorOn(true);
-			break;
-		default:
-			emit codeNotHandled();
-			break;
+			switch(param(n,0))
+			{
+			case 2:			/* keyboard lock */
+				setKeyboardLock(true);
+				break;
+			case 4:			/* insert mode */
+				setAutoInsert(true);
+				break;
+			case 12:		/* set echo mode */
+				setLocalEcho(true);
+				break;
+			case 20:		/* auto new line */
+				setAutoNewLine(true);
+				break;
+			default:
+				emit codeNotHandled();
+				break;
+			}
 		}
 	}
 }
@@ -500,58 +927,71 @@ void CEmulationVT102::doSetModes()
 /** reset terminal modes */
 void CEmulationVT102::doResetModes()
 {
-	QList<int> attrs;
-	QList<int> extAttrs;
-	attributes(attrs,extAttrs);
-	for( int n=0; n < attrs.count(); n++ )
+	for( int n=0; n < paramCount(); n++ )
 	{
-		switch(attrs.at(n))
+		if ( privateMarker() == '?' )
 		{
-		case 2:			/* keyboard lock */
-			setKeyboardLock(false);
-			break;
-		case 4:			/* insert mode */
-			setAutoInsert(false);
-			break;
-		case 12:		/* set echo mode */
-			setLocalEcho(false);
-			break;
-		case 20:		/* auto new line */
-			setAutoNewLine(false);
-			break;
-		default:
-			emit codeNotHandled();
-			break;
+			switch(param(n,0))
+			{
+			case 1:			/* application cursor keys */
+				setApplicationCursorKeys(false);
+				break;
+			case 3:   /* 80 columns */
+				setCols(80);
+				break;
+			case 4:   /* jump scroll */
+				setJumpScroll(true);
+				break;
+			case 5:   /* reverse video */
+				setReverseVideo(false);
+				break;
+			case 6:   /* origin mode */
+				setOriginMode(false);
+				break;
+			case 7:   /* auto wrap */
+				setAutoWrap(false);
+				break;
+			case 25:  /* cursor on */
+				setCursorOn(false);
+				break;
+			case 47:  /* normal screen */
+				setAlternateScreen(false);
+				break;
+			case 1047: /* clear alternate screen, normal screen */
+				setAlternateScreen(false,true);
+				break;
+			case 1049: /* normal screen, restore cursor */
+				if ( alternateScreen() )
+				{
+					setAlternateScreen(false);
+					doRestoreCursorPos();
+				}
+				break;
+			default:
+				emit codeNotHandled();
+				break;
+			}
 		}
-	}
-	for( int n=0; n < extAttrs.count(); n++ )
-	{
-		switch(extAttrs.at(n))
+		else
 		{
-		case 1:			/* application cursor keys */
-			setApplicationCursorKeys(false);
-			break;
-		case 3:   /* 80 columns */
-			setCols(80);
-			break;
-		case 4:   /* jump scroll */
-			setJumpScroll(false);
-			break;
-		case 5:   /* reverse video */
-			setReverseVideo(false);
-			break;
-		case 6:   /* origin mode */
-			setOriginMode(false);
-			break;
-		case 7:   /* auto wrap */
-			setAutoWrap(false);
-			break;
-		case 25:  /* cursor on */
-			setCursorOn(false);
-			break;
-		default:
-			emit codeNotHandled();
-			break;
+			switch(param(n,0))
+			{
+			case 2:			/* keyboard lock */
+				setKeyboardLock(false);
+				break;
+			case 4:			/* insert mode */
+				setAutoInsert(false);
+				break;
+			case 12:		/* set echo mode */
+				setLocalEcho(false);
+				break;
+			case 20:		/* auto new line */
+				setAutoNewLine(false);
+				break;
+			default:
+				emit codeNotHandled();
+				break;
+			}
 		}
 	}
 }
@@ -559,13 +999,12 @@ void CEmulationVT102::doResetModes()
 /* set scroll region */
 void CEmulationVT102::doSetScrollRegion()
 {
-	QList<int> attrs;
-	QList<int> extAttrs;
-	attributes(attrs,extAttrs);
-	if ( attrs.count() == 2 && attrs.at(0) < attrs.at(1) )
+	int top = param(0,1);
+	int bottom = param(1,rows());
+	if ( top < bottom )
 	{
-		setTopMargin(attrs.at(0)-1);
-		setBottomMargin(attrs.at(1)-1);
+		setTopMargin(top-1);
+		setBottomMargin(bottom-1);
 	}
 	else
 		emit codeNotHandled();
@@ -575,23 +1014,22 @@ void CEmulationVT102::doSetScrollRegion()
 /* do cursor position */
 void CEmulationVT102::doCursorPosition()
 {
-	QList<int> attrs;
-	QList<int> extAttrs;
-	int row=0;
-	int col=0;
-	attributes(attrs,extAttrs);
-	if ( attrs.count() == 2 )
-	{
-		row=attrs.at(0)-1;
-		col=attrs.at(1)-1;
-	}
-	doCursorTo(col,row);
+	int row=param(0,1)-1;
+	int col=param(1,1)-1;
+	doCursorTo(qMax(col,0),qMax(row,0));
 }
 
 /* handle a CSI sequence */
 void CEmulationVT102::doCSI(unsigned char ch)
 {
-	switch( (mChar=ch) )
+	mChar=ch;
+	if ( intermediate() || ( privateMarker() && !( privateMarker() == '?' && ( ch == 'h' || ch == 'l' || ch == 'n' ) ) ) )
+	{
+		/* a private or intermediate variant we do not implement, it is not the plain command */
+		emit codeNotHandled();
+		return;
+	}
+	switch( ch )
 	{
 	case 'H':   /* cursor position */
 	case 'f':
@@ -610,47 +1048,38 @@ void CEmulationVT102::doCSI(unsigned char ch)
 		doCursorLeft();
 		break;
 	case 'J':   /* erase display */
+		switch(param(0,0))
 		{
-			int attr = mControlCode.isEmpty() ? 0 : mControlCode.toInt();
-			switch(attr)
-			{
-			case 0:  /* cursor to EOD */
-				doClearScreen(ClearScreenEOD);
-				break;
-			case 1: /* BOD to cursor */
-				doClearScreen(ClearScreenBOD);
-				break;
-			case 2: /* full display */
-				doClearScreen(ClearScreenAOD);
-				break;
-			}
+		case 0:  /* cursor to EOD */
+			doClearScreen(ClearScreenEOD);
+			break;
+		case 1: /* BOD to cursor */
+			doClearScreen(ClearScreenBOD);
+			break;
+		case 2: /* full display */
+			doClearScreen(ClearScreenAOD);
+			break;
 		}
 		break;
 	case 'h':    /* set modes */
 		doSetModes();
 		break;
 	case 'K':   /* erase line */
+		switch(param(0,0))
 		{
-			int attr = mControlCode.isEmpty() ? 0 : mControlCode.toInt();
-			switch(attr)
-			{
-			case 0:  /* cursor to EOL */
-				doClearEOL(ClearLineEOL);
-				break;
-			case 1: /* BOL to cursor */
-				doClearEOL(ClearLineBOL);
-				break;
-			case 2: /* full line */
-				doClearEOL(ClearLineAOL);
-				break;
-			}
+		case 0:  /* cursor to EOL */
+			doClearEOL(ClearLineEOL);
+			break;
+		case 1: /* BOL to cursor */
+			doClearEOL(ClearLineBOL);
+			break;
+		case 2: /* full line */
+			doClearEOL(ClearLineAOL);
+			break;
 		}
 		break;
 	case 'L':    /* insert line(s) */
-		{
-			int num = mControlCode.isEmpty() ? 1 : mControlCode.toInt();
-			doInsertLines(num);
-		}
+		doInsertLines(qMax(param(0,1),1));
 		break;
 	case 'c':   /* device attributes */
 		doDeviceAttributes();
@@ -665,10 +1094,10 @@ void CEmulationVT102::doCSI(unsigned char ch)
 		doReport();
 		break;
 	case 'P':   /* delete character(s) */
-		{
-			int num = mControlCode.isEmpty() ? 1 : mControlCode.toInt();
-			doDeleteCharacters(num);
-		}
+		doDeleteCharacters(qMax(param(0,1),1));
+		break;
+	case 'X':   /* erase character(s) */
+		doEraseCharacters(qMax(param(0,1),1));
 		break;
 	case 'r':   /* set scroll region */
 		setOriginMode(true);
@@ -687,118 +1116,219 @@ void CEmulationVT102::doCSI(unsigned char ch)
 	}
 }
 
-/* process escape codes */
-char CEmulationVT102::doLeadIn(unsigned char ch)
+/* handle an escape sequence */
+void CEmulationVT102::doEscape(unsigned char ch)
 {
-	if ( ch == ASCII_ESC && mControlCode.length() == 0 )
-	{
-		/* ESC char with no-leadin started */
-		mControlCode.append(ch);
-		return ASCII_NUL;
-	}
-	else if ( ch == ASCII_ESC && mControlCode.length() )
+	mChar=ch;
+	if ( intermediate() )
 	{
-		/* ESC char with leadin started */
-		mControlCode.clear();
-		return doLeadIn(ch);
-	}
-	else if ( ch == ASCII_CSI && mControlCode.length() == 0 )
-	{
-		/* CSI char with no leadin started */
-		mControlCode.append(ASCII_ESC);
-		mControlCode.append('[');
-		return ASCII_NUL;
-	}
-	else if ( ch == ASCII_CSI && mControlCode.length() )
-	{
-		/* CSI char with leadin started */
-		mControlCode.clear();
-		return doLeadIn(ch);
-	}
-	else if ( mControlCode.length() == 1 && mControlCode.at(0) == ASCII_ESC )
-	{
-		/* ESC character seen so far */
-		switch ((mChar=ch))
+		switch(intermediate())
 		{
-			case '[':		/* This is a multi-character lead in sequence. */
-			case ')':
-			case '(':
-				mControlCode.append(ch);
-				return ASCII_NUL;
-				break;
-			case 'M':		/* Reverse Index (Cursor Up) */
-				doReverseNewLine();
-				break;
-			case 'D':		/* Index (Cursor Down) */
-				doNewLine();
-				break;
-			case 'E':		/* Next Line. */
-				doCarriageReturn();
-				doNewLine();
-				break;
-			case '7':		/* (DECSC) save state. */
-				doSaveCursorPos();
-				break;
-			case '8':		/* (DECRS) restore saved state. */
-				doRestoreCursorPos();
+			case '(':		/* G0 character set, not supported */
+			case ')':		/* G1 character set, not supported */
 				break;
-			case 'H':		/* FIXME (HTS) set tab stop at current column. */
-				emit codeNotHandled();
-				break;
-			case 'g':		/* visual bell. */
-				doVisualBell();
-				break;
-			case 'c':		/* reset terminal */
-				doReset();
-				break;
-			case 'Z':		/* Identify Terminal */
-				doDeviceAttributes();
-				break;
-			default:		/* did not understand escape code. */
+			default:
 				emit codeNotHandled();
 				break;
 		}
-		mControlCode.clear();
-		return ASCII_NUL;
+		return;
 	}
-	else if ( mControlCode.length() >= 2 )
+	switch (ch)
 	{
-		switch ( mControlCode.at(1) )
-		{
-		case '[':
-			if ( mControlCode.at(1) == '[' )
+		case 'M':		/* Reverse Index (Cursor Up) */
+			doReverseNewLine();
+			break;
+		case 'D':		/* Index (Cursor Down) */
+			doNewLine();
+			break;
+		case 'E':		/* Next Line. */
+			doCarriageReturn();
+			doNewLine();
+			break;
+		case '7':		/* (DECSC) save state. */
+			doSaveCursorPos();
+			break;
+		case '8':		/* (DECRS) restore saved state. */
+			doRestoreCursorPos();
+			break;
+		case 'H':		/* FIXME (HTS) set tab stop at current column. */
+			emit codeNotHandled();
+			break;
+		case 'g':		/* visual bell. */
+			doVisualBell();
+			break;
+		case 'c':		/* reset terminal */
+			doReset();
+			break;
+		case 'Z':		/* Identify Terminal */
+			doDeviceAttributes();
+			break;
+		case '\\':		/* string terminator, the string was closed on the way here */
+			break;
+		default:		/* did not understand escape code. */
+			emit codeNotHandled();
+			break;
+	}
+}
+
+/* handle an operating system command string */
+/**
+ * @brief Execute an OSC string.
+ * @brief 4;c;spec sets palette entries, 10 and 11 the default foreground and background, 104 resets
+ * @brief palette entries. A spec of ? asks for the current color. The cells refer to palette
+ * @brief entries and the defaults, so a change only redraws the screen.
+ */
+void CEmulationVT102::doOperatingSystemCommand()
+{
+	QList<QByteArray> args = QByteArray(oscString(),oscLength()).split(';');
+	bool ok;
+	int command = args.takeFirst().toInt(&ok);
+	QColor color;
+	if ( !ok )
+	{
+		return;
+	}
+	switch(command)
+	{
+		case 4:		/* palette entries */
+			for( int n=0; n+1 < args.count(); n += 2 )
+			{
+				int index = args.at(n).toInt(&ok);
+				if ( ok && index >= 0 && index < 256 )
+				{
+					if ( args.at(n+1) == "?" )
+					{
+						reportColor("4;"+args.at(n),screen()->paletteColor(index));
+					}
+					else if ( colorSpec(args.at(n+1),color) )
+					{
+						screen()->setPaletteColor(index,color);
+					}
+				}
+			}
+			break;
+		case 10:	/* default foreground, a second spec goes on to the background */
+		case 11:	/* default background */
+			for( int n=0; n < args.count() && command+n <= 11; n++ )
 			{
-				if ( (ch>='a'&&ch<='z')||(ch>='A'&&ch<='Z') )
+				bool foreground = ( command+n == 10 );
+				if ( args.at(n) == "?" )
 				{
-					mControlCode.remove(0,2);
-					doCSI(ch);
-					mControlCode.clear();
-					return ASCII_NUL;
+					reportColor(QByteArray::number(command+n),foreground ? screen()->defaultForegroundColor() : screen()->defaultBackgroundColor());
 				}
-				else
+				else if ( colorSpec(args.at(n),color) )
 				{
-					mControlCode.append(ch);
-					if ( mControlCode.length()>25)
+					if ( foreground )
 					{
-						mControlCode.clear();
+						screen()->setDefaultForegroundColor(color);
+					}
+					else
+					{
+						screen()->setDefaultBackgroundColor(color);
 					}
 				}
 			}
 			break;
-		case '(':
-		case ')':
-			mControlCode.clear();
+		case 104:	/* reset palette entries, all of them when none are given */
+			if ( args.isEmpty() || ( args.count() == 1 && args.at(0).isEmpty() ) )
+			{
+				screen()->resetPalette();
+			}
+			for( int n=0; n < args.count(); n++ )
+			{
+				int index = args.at(n).toInt(&ok);
+				if ( ok && index >= 0 && index < 256 )
+				{
+					screen()->resetPalette(index);
+				}
+			}
 			break;
-		default:
-			mControlCode.clear();
+		default:	/* window titles and the like have nowhere to go */
 			break;
+	}
+}
+
+/**
+ * @brief Parse an OSC color.
+ * @brief The X11 rgb:r/g/b form has one to four hex digits per component, the rest is left to QColor.
+ */
+bool CEmulationVT102::colorSpec(const QByteArray& spec, QColor& color)
+{
+	if ( spec.startsWith("rgb:") )
+	{
+		QList<QByteArray> parts = spec.mid(4).split('/');
+		int rgb[3];
+		if ( parts.count() != 3 )
+		{
+			return false;
 		}
-		return ASCII_NUL;
+		for( int n=0; n < 3; n++ )
+		{
+			bool ok;
+			int digits = parts.at(n).length();
+			int value = parts.at(n).toInt(&ok,16);
+			if ( !ok || digits < 1 || digits > 4 )
+			{
+				return false;
+			}
+			rgb[n] = ( value * 255 ) / ( ( 1 << (digits*4) ) - 1 );
+		}
+		color = QColor(rgb[0],rgb[1],rgb[2]);
+		return true;
+	}
+	color.setNamedColor(QString::fromLatin1(spec.constData(),spec.length()));
+	return color.isValid();
+}
+
+/** answer an OSC color query in the rgb:rrrr/gggg/bbbb form */
+void CEmulationVT102::reportColor(const QByteArray& prefix, const QColor& color)
+{
+	QString reply = QString("]%1;rgb:%2/%3/%4")
+		.arg(QString::fromLatin1(prefix.constData()))
+		.arg(color.red()*257,4,16,QChar('0'))
+		.arg(color.green()*257,4,16,QChar('0'))
+		.arg(color.blue()*257,4,16,QChar('0'));
+	emit sendAsciiChar(ASCII_ESC);
+	emit sendAsciiString(reply.toLatin1().data());
+	emit sendAsciiChar(ASCII_BEL);
+}
+
+/* execute a C0 control character */
+void CEmulationVT102::doControl(unsigned char ch)
+{
+	switch( ch )
+	{
+		case ASCII_BEL:
+			doBell();
+			break;
+		case ASCII_BS:
+			inherited::doCursorLeft();
+			break;
+		case ASCII_HT:
+			doTab();
+			break;
+		case ASCII_LF:
+		case ASCII_VT:
+		case ASCII_FF:
+			doNewLine();
+			break;
+		case ASCII_CR:
+			doCarriageReturn();
+			break;
+		default:	/* NUL ENQ SO SI CAN SUB and friends */
+			break;
 	}
-	return ch;
 }
 
-/* received a char */
+/* horizontal tab, fixed stops every eight columns */
+void CEmulationVT102::doTab()
+{
+	QPoint pos = screen()->cursorPos();
+	int col = qMin( (pos.x() & ~7) + 8, cols()-1 );
+	screen()->setCursorPos(col,pos.y());
+}
+
+/* received a char, run it through the parser state machine */
 void CEmulationVT102::receiveChar(unsigned char ch)
 {
 	#ifdef DEBUG_RX
@@ -808,32 +1338,118 @@ void CEmulationVT102::receiveChar(unsigned char ch)
 			putchar(ch);
 		fflush(stdout);
 	#endif
-	switch( (ch = doLeadIn(ch)) )
+	unsigned char transition = sTransition[mState][sByteClass[ch]];
+	unsigned char next = transition >> 4;
+	bool oscEscape = false;
+	if ( mState == StateOscString && next != StateOscString )
 	{
-		case ASCII_ENQ:
-		case ASCII_SO:
-		case ASCII_SI:
-		case ASCII_NUL:
+		/* BEL ends the string, ESC may start ST, anything else (CAN, SUB) throws it away */
+		mOscString[mOscLength]='\0';
+		if ( sByteClass[ch] == ClassBell )
+		{
+			doOperatingSystemCommand();
+		}
+		else if ( sByteClass[ch] == ClassEscape )
+		{
+			oscEscape = true;
+		}
+	}
+	switch( transition & 0x0F )
+	{
+		case ActionPrint:
+			doChar(ch);
 			break;
-		case ASCII_BEL:
-			doBell();
+		case ActionExecute:
+			doControl(ch);
 			break;
-		case ASCII_BS:
-			doCursorLeft();
+		case ActionClear:
+			clearParams();
 			break;
-		case ASCII_LF:
-			doNewLine();
+		case ActionCollect:
+			if ( ch >= '<' && ch <= '?' )
+			{
+				mPrivate = ch;
+			}
+			else if ( !mIntermediate )
+			{
+				mIntermediate = ch;
+			}
 			break;
-		case ASCII_CR:
-			doCarriageReturn();
+		case ActionParam:
+			if ( mParamCount == 0 )
+			{
+				mParams[mParamCount++] = -1;
+			}
+			if ( ch >= '0' && ch <= '9' )
+			{
+				int& p = mParams[mParamCount-1];
+				p = ( p < 0 ) ? (ch-'0') : qMin( p*10 + (ch-'0'), VT102_MAX_PARAM_VALUE );
+			}
+			else if ( mParamCount <= VT102_MAX_PARAMS )
+			{
+				if ( ch == ':' && mParamCount < VT102_MAX_PARAMS )
+				{
+					mSubParams |= 1u << mParamCount;
+				}
+				mParams[mParamCount++] = -1;
+			}
+			else
+			{
+				mParams[VT102_MAX_PARAMS] = -1;
+			}
+			break;
+		case ActionEscDispatch:
+			if ( mOscEscape && ch == '\\' )
+			{
+				doOperatingSystemCommand();
+			}
+			doEscape(ch);
+			clearParams();
+			break;
+		case ActionCsiDispatch:
+			doCSI(ch);
+			clearParams();
+			break;
+		case ActionOscStart:
+			mOscLength=0;
+			break;
+		case ActionOscPut:
+			if ( mOscLength < VT102_MAX_OSC )
+			{
+				mOscString[mOscLength++] = ch;
+			}
 			break;
 		default:
-			doChar(ch);
 			break;
 	}
+	mState = next;
+	mOscEscape = oscEscape;
 	mChar='\0';
 }
 
+/* received a chunk of chars */
+void CEmulationVT102::receiveBytes(const char* data, int len)
+{
+	screen()->beginUpdate();
+	int n=0;
+	while ( n < len )
+	{
+		if ( mState == StateGround )
+		{
+			/* plain printable run, no sequence in progress */
+			int run = CSimd::findControl(data+n,len-n);
+			if ( run > 0 )
+			{
+				doString(data+n,run);
+				n += run;
+				continue;
+			}
+		}
+		CEmulationVT102::receiveChar((unsigned char)data[n++]);
+	}
+	screen()->endUpdate();
+}
+
 /** process key press... */
 void CEmulationVT102::keyPressEvent(QKeyEvent* e)
 {
@@ -890,11 +1506,8 @@ void CEmulationVT102::keyPressEvent(QKeyEvent* e)
 			emit sendAsciiString(text.toLatin1().data());
 			if ( localEcho() )
 			{
-				for ( int n=0; n < text.length(); n++ )
-				{
-					char c = text.toLatin1().at(n);
-					receiveChar(c);
-				}
+				QByteArray echo = text.toLatin1();
+				receiveBytes(echo.constData(),echo.length());
 			}
 			e->accept();
 		}
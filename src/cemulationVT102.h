@@ -23,6 +23,10 @@
 #include <QList>
 #include <QRect>
 
+#define VT102_MAX_PARAMS		16		/* CSI/DCS numeric parameters kept, the rest are dropped */
+#define VT102_MAX_PARAM_VALUE	16383	/* numeric parameters saturate here */
+#define VT102_MAX_OSC			256		/* OSC string bytes kept, the rest are dropped */
+
 /**
 Escape codes for vt102 terminal.
 
@@ -527,6 +531,41 @@ class CEmulationVT102 : public CEmulation
 	Q_OBJECT
 	public:
 
+		/** DEC/ANSI parser states, see http://vt100.net/emu/dec_ansi_parser */
+		typedef enum
+		{
+			StateGround,											/* printing and executing */
+			StateEscape,											/* ESC seen */
+			StateEscapeIntermediate,								/* ESC and intermediate(s) seen */
+			StateCsiEntry,											/* ESC [ or CSI seen */
+			StateCsiParam,											/* collecting CSI parameters */
+			StateCsiIntermediate,									/* CSI intermediate(s) seen */
+			StateCsiIgnore,											/* malformed CSI, swallow to the final */
+			StateOscString,											/* ESC ] collecting the string */
+			StateDcsEntry,											/* ESC P seen */
+			StateDcsParam,											/* collecting DCS parameters */
+			StateDcsIntermediate,									/* DCS intermediate(s) seen */
+			StateDcsPassthrough,									/* DCS data string */
+			StateDcsIgnore,											/* malformed DCS, swallow to ST */
+			StateSosPmApcString,									/* ESC X, ESC ^ or ESC _ string, ignored */
+			StateCount
+		} ParserState;
+
+		/** what to do with the byte on a transition */
+		typedef enum
+		{
+			ActionNone,												/* ignore the byte */
+			ActionPrint,											/* put the byte on the screen */
+			ActionExecute,											/* C0 control */
+			ActionClear,											/* forget parameters and intermediates */
+			ActionCollect,											/* intermediate or private marker */
+			ActionParam,											/* parameter digit or separator */
+			ActionEscDispatch,										/* final of an escape sequence */
+			ActionCsiDispatch,										/* final of a control sequence */
+			ActionOscStart,											/* start of an OSC string */
+			ActionOscPut											/* OSC string byte */
+		} ParserAction;
+
 		CEmulationVT102(CScreen* screen);
 		~CEmulationVT102();
 
@@ -553,12 +592,25 @@ class CEmulationVT102 : public CEmulation
 		virtual void		doScrollDown();							/** scroll screen/region down */
 		virtual void		doNewLine();							/** new line/scroll up */
 		virtual void		doReverseNewLine();						/** reverse new line/scroll down */
+		virtual void		doTab();								/** horizontal tab */
+
+		virtual void		doControl(unsigned char ch);			/** execute a C0 control character */
+		virtual void		doEscape(unsigned char ch);				/** execute an escape sequence */
+		virtual void		doCSI(unsigned char ch);				/** execute a control sequence */
+		virtual void		doOperatingSystemCommand();				/** execute an OSC string */
 
-		virtual char		doLeadIn(unsigned char ch);				/** process the lead-in sequence */
+		inline int			paramCount()						{return qMin(mParamCount,VT102_MAX_PARAMS);}
+		inline int			param(int n, int def)				{return ( n < paramCount() && mParams[n] >= 0 ) ? mParams[n] : def;}
+		inline bool			subParam(int n)						{return n < paramCount() && ( mSubParams & (1u << n) );}	/** param n followed a colon */
+		inline unsigned char privateMarker()					{return mPrivate;}
+		inline unsigned char intermediate()						{return mIntermediate;}
+		inline const char*	oscString()							{return mOscString;}
+		inline int			oscLength()							{return mOscLength;}
 
 	public slots:
 		virtual void		keyPressEvent(QKeyEvent* e);			/** key press input. process and transmit the char. */
 		virtual void		receiveChar(unsigned char ch);			/** received and process an incoming character */
+		virtual void		receiveBytes(const char* data, int len);	/** receive and process a chunk of incoming characters */
 
 	private slots:
 		void				doCodeNotHandled();
@@ -577,9 +629,19 @@ class CEmulationVT102 : public CEmulation
 		void				cursorOn();								/** command cursor on */
 
 	private:
-		bool				attributes(QList<int>& attrs,QList<int>& extEttrs);							/** obtain the attributes from an escape string */
-		void				doCSI(unsigned char ch);				/** recognise and execute a CSI sequence */
-		QByteArray			mControlCode;							/** lead in sequence */
+		void				clearParams();							/** forget parameters, private marker and intermediates */
+		bool				extendedColor(int& n, QRgb& color);		/** the 5;n or 2;r;g;b color, or its colon form, after SGR 38/48 at param n */
+		bool				colorSpec(const QByteArray& spec, QColor& color);	/** parse an OSC color, rgb:r/g/b, #rrggbb or a name */
+		void				reportColor(const QByteArray& prefix, const QColor& color);	/** answer an OSC color query */
+		unsigned char		mState;									/** ParserState */
+		int					mParams[VT102_MAX_PARAMS+1];			/** numeric parameters, -1 when omitted, last slot discards overflow */
+		int					mParamCount;							/** parameters seen so far */
+		quint32				mSubParams;								/** bit n set when param n followed a colon */
+		unsigned char		mPrivate;								/** private marker, one of <=>? or 0 */
+		unsigned char		mIntermediate;							/** first intermediate byte or 0 */
+		char				mOscString[VT102_MAX_OSC+1];			/** OSC string, NUL terminated */
+		int					mOscLength;								/** OSC string length */
+		bool				mOscEscape;								/** the OSC string ended with ESC, dispatch it if a backslash follows */
 		unsigned char		mChar;									/** the last character dispatched (for debugging) */
 		bool				mApplicationCursorKeys;					/** application/normal cursor keys */
 		bool				mOriginMode;							/** origin scroll region(set)/screen(reset) */
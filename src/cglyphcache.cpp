@@ -0,0 +1,144 @@
+/**************************************************************************
+*   Author <mike@pikeaero.com> Mike Sharkey                               *
+*   Copyright (C) 2010 by Pike Aerospace Research Corporation             *
+*                                                                         *
+*   This program is free software: you can redistribute it and/or modify  *
+*   it under the terms of the GNU General Public License as published by  *
+*   the Free Software Foundation, either version 3 of the License, or     *
+*   (at your option) any later version.                                   *
+*                                                                         *
+*   This program is distributed in the hope that it will be useful,       *
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+*   GNU General Public License for more details.                          *
+*                                                                         *
+*   You should have received a copy of the GNU General Public License     *
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+**************************************************************************/
+#include "cglyphcache.h"
+
+CGlyphCache::CGlyphCache()
+: mCellWidth(0)
+, mCellHeight(0)
+, mTinted(CGLYPHCACHE_TINT_BUDGET)
+{
+}
+
+CGlyphCache::~CGlyphCache()
+{
+}
+
+/**
+ * @brief Set the size of a glyph slot, the glyphs are drawn with a font as high as a cell.
+ */
+void CGlyphCache::setCellSize(int width, int height)
+{
+	if ( width != mCellWidth || height != mCellHeight )
+	{
+		mCellWidth = width;
+		mCellHeight = height;
+		mFont = QFont();
+		mFont.setFamily("Monospace");
+		mFont.setPixelSize(height);
+		mBoldFont = mFont;
+		mBoldFont.setBold(true);
+		mTinted.setMaxCost(qMax(CGLYPHCACHE_TINT_BUDGET,width*height*4));	/* always room for one glyph */
+		clear();
+	}
+}
+
+/** forget every glyph and tint */
+void CGlyphCache::clear()
+{
+	mSlots.clear();
+	mTinted.clear();
+	mMasks = QImage();
+}
+
+/** the atlas rectangle of a slot */
+QRect CGlyphCache::slotRect(int slot)
+{
+	return QRect((slot%CGLYPHCACHE_ATLAS_COLS)*mCellWidth,(slot/CGLYPHCACHE_ATLAS_COLS)*mCellHeight,mCellWidth,mCellHeight);
+}
+
+/**
+ * @brief Find the slot of a glyph, rasterizing it on first use.
+ * @return The slot, -1 when the cell size is not known yet.
+ */
+int CGlyphCache::slot(quint32 codepoint, bool bold)
+{
+	if ( mCellWidth <= 0 || mCellHeight <= 0 )
+	{
+		return -1;
+	}
+	quint64 key = ((quint64)codepoint << 1) | (bold ? 1 : 0);
+	int n = mSlots.value(key,-1);
+	if ( n < 0 )
+	{
+		if ( mSlots.count() >= CGLYPHCACHE_MAX_GLYPHS )
+		{
+			clear();
+		}
+		n = mSlots.count();
+		int rows = (n/CGLYPHCACHE_ATLAS_COLS)+1;
+		if ( mMasks.height() < rows*mCellHeight )
+		{
+			/* grow the atlas by doubling its rows */
+			int newRows = qMax(rows,(mMasks.height()/mCellHeight)*2);
+			QImage masks(CGLYPHCACHE_ATLAS_COLS*mCellWidth,newRows*mCellHeight,QImage::Format_ARGB32_Premultiplied);
+			masks.fill(Qt::transparent);
+			if ( !mMasks.isNull() )
+			{
+				QPainter p(&masks);
+				p.setCompositionMode(QPainter::CompositionMode_Source);
+				p.drawImage(QPoint(0,0),mMasks);
+			}
+			mMasks = masks;
+		}
+		uint ucs4 = codepoint;
+		QPainter p(&mMasks);
+		p.setCompositionMode(QPainter::CompositionMode_Source);
+		p.fillRect(slotRect(n),Qt::transparent);
+		p.setCompositionMode(QPainter::CompositionMode_SourceOver);
+		p.setFont(bold ? mBoldFont : mFont);
+		p.setPen(Qt::white);
+		p.drawText(slotRect(n), Qt::AlignCenter, QString::fromUcs4(&ucs4,1));
+		mSlots.insert(key,n);
+	}
+	return n;
+}
+
+/**
+ * @brief A slot tinted with a foreground color, tinted on first use.
+ * @return The tinted glyph, owned by the cache and valid until the next call.
+ */
+const QImage* CGlyphCache::tinted(QRgb fg, int slot)
+{
+	quint64 key = ((quint64)slot << 32) | fg;
+	QImage* image = mTinted.object(key);
+	if ( image == NULL )
+	{
+		QRect r = slotRect(slot);
+		image = new QImage(r.size(),QImage::Format_ARGB32_Premultiplied);
+		QPainter p(image);
+		p.setCompositionMode(QPainter::CompositionMode_Source);
+		p.drawImage(QPoint(0,0),mMasks,r);
+		p.setCompositionMode(QPainter::CompositionMode_SourceIn);
+		p.fillRect(QRect(QPoint(0,0),r.size()),QColor(fg));
+		p.end();
+		mTinted.insert(key,image,mCellWidth*mCellHeight*4);
+	}
+	return image;
+}
+
+/**
+ * @brief Draw a glyph with its top left at pt, over whatever background is already there.
+ */
+void CGlyphCache::draw(QPainter& painter, const QPoint& pt, quint32 codepoint, bool bold, const QColor& fg)
+{
+	int n = slot(codepoint,bold);
+	if ( n >= 0 )
+	{
+		painter.drawImage(pt,*tinted(fg.rgb(),n));
+	}
+}
@@ -0,0 +1,67 @@
+/**************************************************************************
+*   Author <mike@pikeaero.com> Mike Sharkey                               *
+*   Copyright (C) 2010 by Pike Aerospace Research Corporation             *
+*                                                                         *
+*   This program is free software: you can redistribute it and/or modify  *
+*   it under the terms of the GNU General Public License as published by  *
+*   the Free Software Foundation, either version 3 of the License, or     *
+*   (at your option) any later version.                                   *
+*                                                                         *
+*   This program is distributed in the hope that it will be useful,       *
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+*   GNU General Public License for more details.                          *
+*                                                                         *
+*   You should have received a copy of the GNU General Public License     *
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+**************************************************************************/
+#ifndef CGLYPHCACHE_H
+#define CGLYPHCACHE_H
+
+#include <QImage>
+#include <QHash>
+#include <QCache>
+#include <QColor>
+#include <QFont>
+#include <QRect>
+#include <QPainter>
+
+#define CGLYPHCACHE_ATLAS_COLS		32		/* glyph slots per atlas row */
+#define CGLYPHCACHE_MAX_GLYPHS		4096	/* start over when the atlas holds this many glyphs */
+#define CGLYPHCACHE_TINT_BUDGET		(8*1024*1024)	/* bytes of tinted glyphs kept, the least recently used go first */
+
+/**
+ * @brief Pre-rasterized glyphs for cell rendering.
+ * @brief Each (code point, bold) pair is drawn once in white into a slot of an atlas image
+ * @brief sized for the current cell size. Tinted copies of single slots are kept per
+ * @brief foreground color within a byte budget, so drawing a cell is one image copy.
+ */
+class CGlyphCache
+{
+	public:
+		CGlyphCache();
+		virtual ~CGlyphCache();
+
+		inline int			cellWidth()							{return mCellWidth;}
+		inline int			cellHeight()						{return mCellHeight;}
+		inline int			count()								{return mSlots.count();}
+
+		void				setCellSize(int width, int height);	/** size of a glyph slot, the cache is dropped when it changes */
+		void				draw(QPainter& painter, const QPoint& pt, quint32 codepoint, bool bold, const QColor& fg);
+		void				clear();
+
+	private:
+		int					slot(quint32 codepoint, bool bold);
+		QRect				slotRect(int slot);
+		const QImage*		tinted(QRgb fg, int slot);
+
+		int					mCellWidth;
+		int					mCellHeight;
+		QFont				mFont;
+		QFont				mBoldFont;
+		QImage				mMasks;								/** white glyphs on transparent */
+		QHash<quint64,int>	mSlots;								/** atlas slot by (code point<<1)|bold */
+		QCache<quint64,QImage> mTinted;							/** tinted slots by (slot<<32)|color, cost in bytes */
+};
+
+#endif // CGLYPHCACHE_H
@@ -0,0 +1,117 @@
+/**************************************************************************
+*   Author <mike@pikeaero.com> Mike Sharkey                               *
+*   Copyright (C) 2010 by Pike Aerospace Research Corporation             *
+*                                                                         *
+*   This program is free software: you can redistribute it and/or modify  *
+*   it under the terms of the GNU General Public License as published by  *
+*   the Free Software Foundation, either version 3 of the License, or     *
+*   (at your option) any later version.                                   *
+*                                                                         *
+*   This program is distributed in the hope that it will be useful,       *
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+*   GNU General Public License for more details.                          *
+*                                                                         *
+*   You should have received a copy of the GNU General Public License     *
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+**************************************************************************/
+#include "clogdialog.h"
+
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QFileInfo>
+
+#define inherited QDialog
+
+CLogDialog::CLogDialog(QWidget* parent)
+: inherited(parent)
+{
+	mText = new QLineEdit(this);
+	mRegex = new QCheckBox(tr("Regular expression"),this);
+	mFind = new QPushButton(tr("&Find"),this);
+	mFind->setDefault(true);
+	mResults = new QListWidget(this);
+	mResults->setUniformItemSizes(true);
+	mProgress = new QProgressBar(this);
+	mProgress->setRange(0,100);
+	mStatus = new QLabel(this);
+
+	QHBoxLayout* searchLayout = new QHBoxLayout();
+	searchLayout->addWidget(mText);
+	searchLayout->addWidget(mRegex);
+	searchLayout->addWidget(mFind);
+	QHBoxLayout* statusLayout = new QHBoxLayout();
+	statusLayout->addWidget(mStatus);
+	statusLayout->addWidget(mProgress);
+	QVBoxLayout* layout = new QVBoxLayout(this);
+	layout->addLayout(searchLayout);
+	layout->addWidget(mResults);
+	layout->addLayout(statusLayout);
+	resize(720,480);
+
+	/* Enter in the text clicks the default button, so there is no returnPressed() connection */
+	QObject::connect(mFind,SIGNAL(clicked()),this,SLOT(search()));
+	QObject::connect(&mSearch,SIGNAL(found(int,const QStringList&)),this,SLOT(found(int,const QStringList&)));
+	QObject::connect(&mSearch,SIGNAL(progress(int,int)),this,SLOT(progress(int,int)));
+	QObject::connect(&mSearch,SIGNAL(done(int)),this,SLOT(searchFinished(int)));
+}
+
+CLogDialog::~CLogDialog()
+{
+	mSearch.stop();
+	mSearch.wait();
+}
+
+/** the log to search, false when it can not be read */
+bool CLogDialog::open(const QString& path)
+{
+	if ( !mSearch.open(path) )
+	{
+		return false;
+	}
+	setWindowTitle(tr("Log")+" - "+QFileInfo(path).fileName());
+	mStatus->setText(tr("%1 bytes").arg(mSearch.size()));
+	return true;
+}
+
+/** start over with the current text */
+void CLogDialog::search()
+{
+	mResults->clear();
+	mProgress->setValue(0);
+	mStatus->setText(tr("Searching..."));
+	mSearch.search(mText->text(),mRegex->isChecked());
+}
+
+/** matching lines arrived from the scan, the ones of a search that was replaced are dropped */
+void CLogDialog::found(int generation, const QStringList& lines)
+{
+	if ( generation == mSearch.generation() )
+	{
+		mResults->addItems(lines);
+	}
+}
+
+void CLogDialog::progress(int generation, int percent)
+{
+	if ( generation == mSearch.generation() )
+	{
+		mProgress->setValue(percent);
+	}
+}
+
+void CLogDialog::searchFinished(int generation)
+{
+	if ( generation != mSearch.generation() )
+	{
+		return;
+	}
+	if ( mSearch.matches() >= CLOGSEARCH_MAX_MATCHES )
+	{
+		mStatus->setText(tr("First %1 matching lines").arg(mSearch.matches()));
+	}
+	else
+	{
+		mStatus->setText(tr("%1 matching lines").arg(mSearch.matches()));
+	}
+}
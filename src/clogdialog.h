@@ -0,0 +1,60 @@
+/**************************************************************************
+*   Author <mike@pikeaero.com> Mike Sharkey                               *
+*   Copyright (C) 2010 by Pike Aerospace Research Corporation             *
+*                                                                         *
+*   This program is free software: you can redistribute it and/or modify  *
+*   it under the terms of the GNU General Public License as published by  *
+*   the Free Software Foundation, either version 3 of the License, or     *
+*   (at your option) any later version.                                   *
+*                                                                         *
+*   This program is distributed in the hope that it will be useful,       *
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+*   GNU General Public License for more details.                          *
+*                                                                         *
+*   You should have received a copy of the GNU General Public License     *
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+**************************************************************************/
+#ifndef CLOGDIALOG_H
+#define CLOGDIALOG_H
+
+#include <QDialog>
+#include <QLineEdit>
+#include <QCheckBox>
+#include <QPushButton>
+#include <QListWidget>
+#include <QProgressBar>
+#include <QLabel>
+
+#include "clogsearch.h"
+
+/**
+ * @brief The "Open Log" window, searches a raw capture file and lists the matching lines
+ * @brief as they are found.
+ */
+class CLogDialog : public QDialog
+{
+	Q_OBJECT
+	public:
+		CLogDialog(QWidget* parent=0);
+		virtual ~CLogDialog();
+
+		bool				open(const QString& path);				/** the log to search, false when it can not be read */
+
+	private slots:
+		void				search();
+		void				found(int generation, const QStringList& lines);
+		void				progress(int generation, int percent);
+		void				searchFinished(int generation);
+
+	private:
+		CLogSearch			mSearch;
+		QLineEdit*			mText;
+		QCheckBox*			mRegex;
+		QPushButton*		mFind;
+		QListWidget*		mResults;
+		QProgressBar*		mProgress;
+		QLabel*				mStatus;
+};
+
+#endif // CLOGDIALOG_H
@@ -0,0 +1,226 @@
+/**************************************************************************
+*   Author <mike@pikeaero.com> Mike Sharkey                               *
+*   Copyright (C) 2010 by Pike Aerospace Research Corporation             *
+*                                                                         *
+*   This program is free software: you can redistribute it and/or modify  *
+*   it under the terms of the GNU General Public License as published by  *
+*   the Free Software Foundation, either version 3 of the License, or     *
+*   (at your option) any later version.                                   *
+*                                                                         *
+*   This program is distributed in the hope that it will be useful,       *
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+*   GNU General Public License for more details.                          *
+*                                                                         *
+*   You should have received a copy of the GNU General Public License     *
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+**************************************************************************/
+#include "clogsearch.h"
+#include "csimd.h"
+
+#include <string.h>
+#include <limits.h>
+
+#define inherited QThread
+
+CLogSearch::CLogSearch(QObject* parent)
+: inherited(parent)
+, mData(NULL)
+, mSize(0)
+, mUseRegex(false)
+, mMatches(0)
+, mGeneration(0)
+, mStop(0)
+{
+}
+
+CLogSearch::~CLogSearch()
+{
+	stop();
+	wait();
+}
+
+/**
+ * @brief Map a log file for searching.
+ * @return false when the file can not be opened or mapped.
+ */
+bool CLogSearch::open(const QString& path)
+{
+	stop();
+	wait();
+	if ( mFile.isOpen() )
+	{
+		mFile.close();
+	}
+	mData = NULL;
+	mSize = 0;
+	mFile.setFileName(path);
+	if ( !mFile.open(QIODevice::ReadOnly) )
+	{
+		return false;
+	}
+	mSize = mFile.size();
+	if ( mSize > 0 )
+	{
+		mData = (const char*)mFile.map(0,mSize);
+		if ( mData == NULL )
+		{
+			mFile.close();
+			mSize = 0;
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * @brief Request the scan to terminate.
+ */
+void CLogSearch::stop()
+{
+	mStop.storeRelease(1);
+}
+
+/**
+ * @brief Start a search from the top of the file.
+ * @param text Plain text, or a regular expression matched against each line.
+ */
+void CLogSearch::search(const QString& text, bool regex)
+{
+	stop();
+	wait();
+	mUseRegex = regex;
+	mText = text.toLatin1();
+#if QT_VERSION >= 0x050000
+	mRegex = QRegularExpression(text);
+	#if QT_VERSION >= 0x050400
+		mRegex.optimize();
+	#endif
+#else
+	mRegex = QRegExp(text);
+#endif
+	mMatches = 0;
+	++mGeneration;
+	mStop.storeRelease(0);
+	start();
+}
+
+/** the offset of the line feed ending the line at, CLOGSEARCH_LONG_LINE bytes on or the end of the file when none */
+qint64 CLogSearch::lineEnd(qint64 at)
+{
+	qint64 limit = qMin(mSize-at,(qint64)CLOGSEARCH_LONG_LINE);
+	const char* p = (const char*)memchr(mData+at,'\n',limit);
+	return ( p != NULL ) ? p-mData : at+limit;
+}
+
+/** the start of the line after the one ending at eol */
+qint64 CLogSearch::nextLine(qint64 eol)
+{
+	return ( eol < mSize && mData[eol] == '\n' ) ? eol+1 : eol;
+}
+
+/**
+ * @brief The first match starting in at..end.
+ * @return The offset of the match, a regular expression match is reported at its line start. -1 when none.
+ */
+qint64 CLogSearch::findFrom(qint64 at, qint64 end)
+{
+	if ( mUseRegex )
+	{
+		while ( at < end )
+		{
+			qint64 eol = lineEnd(at);
+			QString line = QString::fromLatin1(mData+at,(int)(eol-at));
+#if QT_VERSION >= 0x050000
+			if ( mRegex.match(line).hasMatch() )
+#else
+			if ( mRegex.indexIn(line) >= 0 )
+#endif
+			{
+				return at;
+			}
+			at = nextLine(eol);
+		}
+		return -1;
+	}
+	/* a match may run past end, so scan text-1 bytes further, in pieces findText() can take */
+	qint64 len = end-at;
+	qint64 scan = qMin(len+mText.size()-1,mSize-at);
+	qint64 from = 0;
+	while ( from < len )
+	{
+		int piece = (int)qMin(scan-from,(qint64)INT_MAX);
+		int found = CSimd::findText(mData+at+from,piece,mText.constData(),mText.size());
+		if ( found < piece )
+		{
+			return ( from+found < len ) ? at+from+found : -1;
+		}
+		if ( from+piece >= scan )
+		{
+			break;
+		}
+		from += piece-(mText.size()-1);
+	}
+	return -1;
+}
+
+/**
+ * @brief The scan. Matching lines are counted, cut to CLOGSEARCH_MAX_LINE and reported
+ * @brief once per chunk, the line number comes from counting line feeds up to each match.
+ * @brief A chunk ends at a line feed, or CLOGSEARCH_LONG_LINE further on when there is none, so
+ * @brief a regular expression sees whole lines and a stop request is seen every chunk.
+ */
+void CLogSearch::run()
+{
+	int generation = mGeneration;
+	if ( mData == NULL || ( !mUseRegex && mText.isEmpty() ) )
+	{
+		emit progress(generation,100);
+		emit done(generation);
+		return;
+	}
+	qint64 at = 0;
+	qint64 counted = 0;								/* line feeds are counted up to here */
+	qint64 line = 1;								/* the line number at counted */
+	while ( at < mSize && mMatches < CLOGSEARCH_MAX_MATCHES && !mStop.loadAcquire() )
+	{
+		qint64 end = qMin(at+CLOGSEARCH_CHUNK,mSize);
+		if ( end < mSize )
+		{
+			end = nextLine(lineEnd(end-1));
+		}
+		QStringList lines;
+		while ( at < end && mMatches < CLOGSEARCH_MAX_MATCHES )
+		{
+			qint64 hit = findFrom(at,end);
+			if ( hit < 0 )
+			{
+				at = end;
+				break;
+			}
+			qint64 start = hit;
+			qint64 first = qMax(counted,hit-CLOGSEARCH_LONG_LINE);
+			while ( start > first && mData[start-1] != '\n' )
+			{
+				--start;
+			}
+			qint64 eol = lineEnd(hit);
+			while ( counted < start )
+			{
+				int n = (int)qMin(start-counted,(qint64)CLOGSEARCH_CHUNK);
+				line += CSimd::countByte(mData+counted,n,'\n');
+				counted += n;
+			}
+			lines.append(QString("%1: %2").arg(line).arg(QString::fromLatin1(mData+start,(int)qMin(eol-start,(qint64)CLOGSEARCH_MAX_LINE))));
+			++mMatches;
+			at = nextLine(eol);
+		}
+		if ( !lines.isEmpty() )
+		{
+			emit found(generation,lines);
+		}
+		emit progress(generation,(int)((qMin(at,mSize)*100)/mSize));
+	}
+	emit progress(generation,100);
+	emit done(generation);
+}
@@ -0,0 +1,90 @@
+/**************************************************************************
+*   Author <mike@pikeaero.com> Mike Sharkey                               *
+*   Copyright (C) 2010 by Pike Aerospace Research Corporation             *
+*                                                                         *
+*   This program is free software: you can redistribute it and/or modify  *
+*   it under the terms of the GNU General Public License as published by  *
+*   the Free Software Foundation, either version 3 of the License, or     *
+*   (at your option) any later version.                                   *
+*                                                                         *
+*   This program is distributed in the hope that it will be useful,       *
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+*   GNU General Public License for more details.                          *
+*                                                                         *
+*   You should have received a copy of the GNU General Public License     *
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+**************************************************************************/
+#ifndef CLOGSEARCH_H
+#define CLOGSEARCH_H
+
+#include <QThread>
+#include <QAtomicInt>
+#include <QFile>
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#if QT_VERSION >= 0x050000
+	#include <QRegularExpression>
+#else
+	#include <QRegExp>
+#endif
+
+#define CLOGSEARCH_CHUNK			(16*1024*1024)	/* bytes scanned between progress reports */
+#define CLOGSEARCH_MAX_MATCHES		100000			/* stop after this many matching lines */
+#define CLOGSEARCH_MAX_LINE			512				/* characters of a matching line reported */
+#define CLOGSEARCH_LONG_LINE		(64*1024)		/* a longer line is searched and reported as several */
+
+/**
+ * @brief Searches a raw capture file on a thread of its own.
+ * @brief The file is memory mapped and scanned a chunk at a time, plain text with CSimd::findText()
+ * @brief and regular expressions a line at a time, a line longer than CLOGSEARCH_LONG_LINE is
+ * @brief taken as several. The lines that match are reported with their
+ * @brief line number through found() at the end of every chunk, so results stream in while the
+ * @brief scan is still running. Every search has a generation number that its signals carry, a
+ * @brief receiver drops the ones of a search that was stopped but still had signals queued.
+ */
+class CLogSearch : public QThread
+{
+	Q_OBJECT
+	public:
+		CLogSearch(QObject* parent=0);
+		virtual ~CLogSearch();
+
+		bool				open(const QString& path);				/** map a log file, false when it can not be read */
+		inline qint64		size()									{return mSize;}
+		inline int			matches()								{return mMatches;}
+		inline int			generation()							{return mGeneration;}	/** the number of the latest search */
+
+		void				search(const QString& text, bool regex);	/** start a search, a running one is stopped first */
+		void				stop();									/** ask run() to return, then wait() */
+
+	signals:
+		void				found(int generation, const QStringList& lines);	/** "line: text" for each matching line */
+		void				progress(int generation, int percent);
+		void				done(int generation);					/** the scan ran to the end or was stopped */
+
+	protected:
+		void				run();
+
+	private:
+		qint64				findFrom(qint64 at, qint64 end);
+		qint64				lineEnd(qint64 at);
+		qint64				nextLine(qint64 eol);
+
+		QFile				mFile;
+		const char*			mData;									/** the file mapped */
+		qint64				mSize;
+		QByteArray			mText;									/** plain text to find */
+		bool				mUseRegex;
+#if QT_VERSION >= 0x050000
+		QRegularExpression	mRegex;
+#else
+		QRegExp				mRegex;
+#endif
+		int					mMatches;
+		int					mGeneration;							/** bumped by every search() */
+		QAtomicInt			mStop;
+};
+
+#endif // CLOGSEARCH_H
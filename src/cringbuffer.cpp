@@ -0,0 +1,139 @@
+/**************************************************************************
+*   Author <mike@pikeaero.com> Mike Sharkey                               *
+*   Copyright (C) 2010 by Pike Aerospace Research Corporation             *
+*                                                                         *
+*   This program is free software: you can redistribute it and/or modify  *
+*   it under the terms of the GNU General Public License as published by  *
+*   the Free Software Foundation, either version 3 of the License, or     *
+*   (at your option) any later version.                                   *
+*                                                                         *
+*   This program is distributed in the hope that it will be useful,       *
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+*   GNU General Public License for more details.                          *
+*                                                                         *
+*   You should have received a copy of the GNU General Public License     *
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+**************************************************************************/
+#include "cringbuffer.h"
+#include <string.h>
+
+CRingBuffer::CRingBuffer(int size)
+: mBuffer(NULL)
+, mMask(0)
+, mHead(0)
+, mTail(0)
+{
+	unsigned int capacity=1;
+	while ( capacity < (unsigned int)size )
+	{
+		capacity <<= 1;
+	}
+	mBuffer = new char[capacity];
+	mMask = capacity-1;
+}
+
+CRingBuffer::~CRingBuffer()
+{
+	delete [] mBuffer;
+}
+
+/**
+ * @brief Obtain the contiguous free space at the head of the ring.
+ * @param len Returns the number of bytes which may be written at the returned pointer.
+ * @return Pointer to write to, len is zero when the ring is full.
+ */
+char* CRingBuffer::writePtr(int& len)
+{
+	unsigned int head = (unsigned int)mHead.load();
+	unsigned int tail = (unsigned int)mTail.loadAcquire();
+	unsigned int offset = head & mMask;
+	unsigned int room = (mMask+1) - (head-tail);
+	unsigned int toEnd = (mMask+1) - offset;
+	len = (int)(room < toEnd ? room : toEnd);
+	return mBuffer+offset;
+}
+
+/**
+ * @brief Make len bytes written at writePtr() visible to the consumer.
+ */
+void CRingBuffer::commitWrite(int len)
+{
+	mHead.storeRelease( (int)((unsigned int)mHead.load()+(unsigned int)len) );
+}
+
+/**
+ * @brief Copy as much of data as fits into the ring.
+ * @return The number of bytes written.
+ */
+int CRingBuffer::write(const char* data, int len)
+{
+	int written=0;
+	while ( written < len )
+	{
+		int n;
+		char* p = writePtr(n);
+		if ( n == 0 )
+		{
+			break;
+		}
+		if ( n > len-written )
+		{
+			n = len-written;
+		}
+		memcpy(p,data+written,n);
+		commitWrite(n);
+		written += n;
+	}
+	return written;
+}
+
+/**
+ * @brief Obtain the contiguous readable bytes at the tail of the ring.
+ * @param len Returns the number of bytes which may be read at the returned pointer.
+ * @return Pointer to read from, len is zero when the ring is empty.
+ */
+const char* CRingBuffer::readPtr(int& len)
+{
+	unsigned int tail = (unsigned int)mTail.load();
+	unsigned int head = (unsigned int)mHead.loadAcquire();
+	unsigned int offset = tail & mMask;
+	unsigned int used = head-tail;
+	unsigned int toEnd = (mMask+1) - offset;
+	len = (int)(used < toEnd ? used : toEnd);
+	return mBuffer+offset;
+}
+
+/**
+ * @brief Hand len bytes obtained from readPtr() back to the producer.
+ */
+void CRingBuffer::commitRead(int len)
+{
+	mTail.storeRelease( (int)((unsigned int)mTail.load()+(unsigned int)len) );
+}
+
+/**
+ * @brief Copy up to len bytes out of the ring.
+ * @return The number of bytes read.
+ */
+int CRingBuffer::read(char* data, int len)
+{
+	int done=0;
+	while ( done < len )
+	{
+		int n;
+		const char* p = readPtr(n);
+		if ( n == 0 )
+		{
+			break;
+		}
+		if ( n > len-done )
+		{
+			n = len-done;
+		}
+		memcpy(data+done,p,n);
+		commitRead(n);
+		done += n;
+	}
+	return done;
+}
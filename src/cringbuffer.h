@@ -0,0 +1,59 @@
+/**************************************************************************
+*   Author <mike@pikeaero.com> Mike Sharkey                               *
+*   Copyright (C) 2010 by Pike Aerospace Research Corporation             *
+*                                                                         *
+*   This program is free software: you can redistribute it and/or modify  *
+*   it under the terms of the GNU General Public License as published by  *
+*   the Free Software Foundation, either version 3 of the License, or     *
+*   (at your option) any later version.                                   *
+*                                                                         *
+*   This program is distributed in the hope that it will be useful,       *
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+*   GNU General Public License for more details.                          *
+*                                                                         *
+*   You should have received a copy of the GNU General Public License     *
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+**************************************************************************/
+#ifndef CRINGBUFFER_H
+#define CRINGBUFFER_H
+
+#include <QAtomicInt>
+
+#define CRINGBUFFER_DEFAULT_SIZE	(1024*1024)		/* about ten seconds at 921600 baud */
+
+/**
+ * @brief A lock-free single-producer / single-consumer byte ring.
+ * @brief Exactly one thread may call the producer methods (writePtr/commitWrite/write) and
+ * @brief exactly one other thread may call the consumer methods (readPtr/commitRead/read).
+ * @brief The head and tail are free running counters, the capacity is always a power of two.
+ */
+class CRingBuffer
+{
+	public:
+		CRingBuffer(int size=CRINGBUFFER_DEFAULT_SIZE);
+		virtual ~CRingBuffer();
+
+		inline int			capacity()						{return (int)mMask+1;}
+		inline int			available()						{return (int)((unsigned int)mHead.loadAcquire()-(unsigned int)mTail.loadAcquire());}
+		inline int			space()							{return capacity()-available();}
+		inline bool			isEmpty()						{return available()==0;}
+
+		/* producer side */
+		char*				writePtr(int& len);				/** contiguous free space at the head */
+		void				commitWrite(int len);			/** publish len bytes written at writePtr() */
+		int					write(const char* data, int len);
+
+		/* consumer side */
+		const char*			readPtr(int& len);				/** contiguous readable bytes at the tail */
+		void				commitRead(int len);			/** release len bytes obtained from readPtr() */
+		int					read(char* data, int len);
+
+	private:
+		char*				mBuffer;						/** the storage */
+		unsigned int		mMask;							/** capacity-1 */
+		QAtomicInt			mHead;							/** total bytes ever written, owned by the producer */
+		QAtomicInt			mTail;							/** total bytes ever read, owned by the consumer */
+};
+
+#endif // CRINGBUFFER_H
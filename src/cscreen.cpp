@@ -17,6 +17,13 @@
 **************************************************************************/
 #include "cscreen.h"
 #include <QPainter>
+#if QT_VERSION >= 0x050000
+#include <QGuiApplication>
+#include <QScreen>
+#endif
+#include <string.h>
+#include <limits.h>
+#include <algorithm>
 
 #define inherited QWidget
 
@@ -24,14 +31,40 @@
 CScreen::CScreen(QWidget *parent)
 : inherited(parent)
 , mCursor(0,0)
-, mBackgroundColor(QColor(0,0,0))
-, mForegroundColor(QColor(255,255,255))
-, mBlink(false)
-, mBold(false)
-, mReverse(false)
-, mUnderline(false)
+, mCursorStyle(CursorBlockInvert)
+, mCursorVisible(true)
+, mCursorState(true)
+, mBlinkTimer(-1)
+, mBlinkTicks(0)
+, mBlinkState(true)
+, mStyleId(0)
+, mUpdateDepth(0)
+, mDamaged(false)
+, mDamageAll(false)
+, mCursorDamaged(false)
+, mPaintedCursor(0,0)
+, mScrollTop(0)
+, mScrollHeight(0)
+, mScrollLines(0)
+, mScrollJumped(false)
+, mJumpScroll(true)
+, mFrameRate(0)
+, mFrameTimer(-1)
+, mFrameAll(false)
+, mImmediateFrame(false)
+, mFindLine(-1)
+, mFindCol(0)
+, mReverseScreen(false)
+, mBellTimer(-1)
 {
 	cells().setScreen(this);
+	cells().setScrollback(&mScrollback);
+	setAttribute(Qt::WA_OpaquePaintEvent);
+	mScrollBar = new QScrollBar(Qt::Vertical,this);
+	mScrollBar->setFocusPolicy(Qt::NoFocus);
+	updateScrollBar();
+	QObject::connect(mScrollBar,SIGNAL(valueChanged(int)),this,SLOT(scrollTo(int)));
+	updateBlinkTimer();
 }
 
 CScreen::~CScreen()
@@ -40,15 +73,333 @@ CScreen::~CScreen()
 
 void CScreen::resizeEvent(QResizeEvent* e)
 {
-	cells().setRect(QRect(0,0,e->size().width(),e->size().height()));
+	int w = mScrollBar->sizeHint().width();
+	mScrollBar->setGeometry(e->size().width()-w,0,w,e->size().height());
+	cells().setRect(QRect(0,0,e->size().width()-w,e->size().height()));
 	inherited::resizeEvent(e);
 	cells().sync();
 }
 
 void CScreen::paintEvent(QPaintEvent* e)
 {
+	renderBacking();
 	QPainter painter(this);
-	cells().draw(painter,e->rect());
+	painter.drawImage(e->rect().topLeft(),mBacking,e->rect());
+	drawCursor(painter);
+	if ( mBellTimer >= 0 )
+	{
+		/* the visual bell inverts the frame, the backing store is left alone */
+		painter.setCompositionMode(QPainter::CompositionMode_Difference);
+		painter.fillRect(e->rect(),Qt::white);
+	}
+}
+
+/** scroll through history, three lines a notch */
+void CScreen::wheelEvent(QWheelEvent* e)
+{
+#if QT_VERSION >= 0x050000
+	int delta = e->angleDelta().y();
+#else
+	int delta = e->delta();
+#endif
+	setViewOffset(viewOffset()+(delta/40));
+}
+
+/** page through history on Shift+PgUp/PgDn/Home/End, true when the key was used */
+bool CScreen::pageKey(QKeyEvent* e)
+{
+	if ( e->modifiers() & Qt::ShiftModifier )
+	{
+		switch( e->key() )
+		{
+			case Qt::Key_PageUp:	setViewOffset(viewOffset()+rows());	return true;
+			case Qt::Key_PageDown:	setViewOffset(viewOffset()-rows());	return true;
+			case Qt::Key_Home:		setViewOffset(scrollback().lines());	return true;
+			case Qt::Key_End:		setViewOffset(0);						return true;
+			default:				break;
+		}
+	}
+	return false;
+}
+
+/** show lines of history above the screen, 0 for the live screen */
+void CScreen::setViewOffset(int lines)
+{
+	cells().setViewOffset(lines);
+	updateScrollBar();
+}
+
+/** show the alternate screen or the normal one, the alternate screen keeps no history */
+void CScreen::setAlternateScreen(bool b, bool clear)
+{
+	clearFind();
+	cells().setAlternate(b,clear);
+	updateScrollBar();
+}
+
+/** draw every cell with its colors swapped, DECSCNM */
+void CScreen::setReverseScreen(bool b)
+{
+	if ( mReverseScreen != b )
+	{
+		mReverseScreen = b;
+		invalidate();
+	}
+}
+
+/**
+ * @brief Flash the screen inverted for a moment.
+ * @brief The inversion is drawn over the frame when painting, so a bell costs a frame to show it
+ * @brief and one to take it away. Bells while flashing are absorbed.
+ */
+void CScreen::visualBell()
+{
+	if ( mBellTimer < 0 )
+	{
+		mBellTimer = startTimer(CSCREEN_BELL_MSEC);
+		requestFrame();
+	}
+}
+
+/** bring a line into view, lines count from the oldest in history and the screen follows */
+void CScreen::showLine(int line)
+{
+	int history = cells().historyLines();
+	if ( line >= history )
+	{
+		setViewOffset(0);
+	}
+	else if ( line < history-viewOffset() || line >= (history-viewOffset())+rows() )
+	{
+		setViewOffset((history-line)+(rows()/2));
+	}
+}
+
+/**
+ * @brief Find text, ignoring case, starting next to the last match.
+ * @brief The history and the screen read as one list of lines, the oldest first. Without a last
+ * @brief match a backward search starts at the bottom of the screen and a forward one at the top
+ * @brief of history. The match is marked and brought into view.
+ */
+bool CScreen::find(const QString& text, bool backward)
+{
+	QVector<uint> needle = text.toUcs4();
+	if ( needle.isEmpty() )
+	{
+		return false;
+	}
+	for( int n=0; n < needle.count(); n++ )
+	{
+		needle[n] = CScrollback::fold(needle[n]);
+	}
+	int history = cells().historyLines();
+	int line;
+	int col;
+	if ( mFindLine < 0 || mFindLine >= history+rows() )
+	{
+		line = backward ? (history+rows())-1 : 0;
+		col = backward ? INT_MAX : 0;
+	}
+	else
+	{
+		line = mFindLine;
+		col = backward ? mFindCol-1 : mFindCol+1;
+	}
+	int found = -1;
+	if ( !backward && line < history )
+	{
+		found = scrollback().find(needle,line,col,false);
+		line = history;
+		col = 0;
+	}
+	while ( found < 0 && line >= history && line < history+rows() )
+	{
+		col = CScrollback::findInLine(cells().line(line-history),cols(),needle,col,backward);
+		if ( col >= 0 )
+		{
+			found = line;
+			break;
+		}
+		line += backward ? -1 : 1;
+		col = backward ? INT_MAX : 0;
+	}
+	if ( found < 0 && backward && line >= 0 && line < history )
+	{
+		found = scrollback().find(needle,line,col,true);
+	}
+	if ( found < 0 )
+	{
+		return false;
+	}
+	mFindLine = found;
+	mFindCol = col;
+	cells().setHighlight(found,col,needle.count());
+	showLine(found);
+	return true;
+}
+
+/** forget the last match */
+void CScreen::clearFind()
+{
+	mFindLine = -1;
+	cells().setHighlight(-1,0,0);
+}
+
+/** the scroll bar moved */
+void CScreen::scrollTo(int value)
+{
+	cells().setViewOffset(mScrollBar->maximum()-value);
+}
+
+/** match the scroll bar to the history and the view */
+void CScreen::updateScrollBar()
+{
+	mScrollBar->blockSignals(true);
+	mScrollBar->setRange(0,cells().historyLines());
+	mScrollBar->setPageStep(qMax(rows(),1));
+	mScrollBar->setValue(cells().historyLines()-viewOffset());
+	mScrollBar->blockSignals(false);
+}
+
+/** one tick of the blink clock, blink the cursor and every so often the blinking text */
+void CScreen::timerEvent(QTimerEvent* e)
+{
+	if ( e->timerId() == mBlinkTimer )
+	{
+		beginUpdate();
+		if ( cursorVisible() )
+		{
+			mCursorState = !mCursorState;
+			updateCursor();
+		}
+		if ( ++mBlinkTicks >= CSCREEN_TEXT_BLINK_TICKS )
+		{
+			mBlinkTicks = 0;
+			mBlinkState = !mBlinkState;
+			invalidateBlinking();
+		}
+		endUpdate();
+		updateBlinkTimer();
+	}
+	else if ( e->timerId() == mFrameTimer )
+	{
+		issueFrame();
+	}
+	else if ( e->timerId() == mBellTimer )
+	{
+		killTimer(mBellTimer);
+		mBellTimer = -1;
+		requestFrame();
+	}
+	else
+	{
+		inherited::timerEvent(e);
+	}
+}
+
+/** run the blink clock only while the cursor or some text blinks */
+void CScreen::updateBlinkTimer()
+{
+	bool needed = cursorVisible() || cells().blinkRowCount() > 0;
+	if ( needed && mBlinkTimer < 0 )
+	{
+		mBlinkTimer = startTimer(CSCREEN_BLINK_MSEC);
+	}
+	else if ( !needed && mBlinkTimer >= 0 )
+	{
+		killTimer(mBlinkTimer);
+		mBlinkTimer = -1;
+		mBlinkTicks = 0;
+		mBlinkState = true;
+	}
+}
+
+/** repaint the runs of blinking cells, rows found to have none leave the index */
+void CScreen::invalidateBlinking()
+{
+	for( int y=0; y < rows() && cells().blinkRowCount() > 0; y++ )
+	{
+		if ( cells().rowBlinks(y) )
+		{
+			const CCharCell* line = cells().line(y);
+			bool found = false;
+			int x=0;
+			while ( x < cols() )
+			{
+				if ( cells().styles().blink(line[x].style()) )
+				{
+					int first = x;
+					while ( x < cols() && cells().styles().blink(line[x].style()) )
+					{
+						++x;
+					}
+					invalidateSpan(first,y,x-first);
+					found = true;
+				}
+				else
+				{
+					++x;
+				}
+			}
+			if ( !found )
+			{
+				cells().unmarkBlink(y);
+			}
+		}
+	}
+}
+
+/** draw the cursor over the cell it sits on */
+void CScreen::drawCursor(QPainter& painter)
+{
+	mPaintedCursor = mCursor;
+	if ( mCursorVisible && mCursorState && cells().isValidCell(mCursor.x(),mCursor.y()+viewOffset()) )
+	{
+		const CCharCell& c = cell(mCursor.x(),mCursor.y());
+		QRect r = cursorRect(mCursor);
+		QColor fg = cells().foregroundColor(c.style());
+		QColor bg = cells().backgroundColor(c.style());
+		if ( ( cells().styles().reverse(c.style()) != c.select() ) != reverseScreen() )
+		{
+			qSwap(fg,bg);
+		}
+		switch(cursorStyle())
+		{
+			case CursorUnderline:
+				painter.setPen(fg);
+				painter.drawLine(r.bottomLeft(),r.bottomRight());
+				break;
+			case CursorBlockOutline:
+				painter.setPen(fg);
+				painter.drawRect(r.adjusted(0,0,-1,-1));
+				break;
+			case CursorBlockInvert:
+				painter.fillRect(r,fg);
+				if ( c.codepoint() != ' ' )
+				{
+					cells().glyphs().setCellSize(r.width(),r.height());
+					cells().glyphs().draw(painter,r.topLeft(),c.codepoint(),cells().styles().bold(c.style()),bg);
+				}
+				break;
+		}
+	}
+}
+
+void CScreen::setCursorStyle(CursorStyle cs)
+{
+	mCursorStyle=cs;
+	updateCursor();
+}
+
+void CScreen::setCursorVisible(bool b)
+{
+	if ( mCursorVisible != b )
+	{
+		mCursorVisible=b;
+		mCursorState=true;
+		updateCursor();
+		updateBlinkTimer();
+	}
 }
 
 void CScreen::mousePressEvent(QMouseEvent *e)
@@ -65,8 +416,9 @@ void CScreen::mouseMoveEvent(QMouseEvent *e)
 	{
 		mSelectPt2 = e->pos();
 		QRect r = QRect(mSelectPt1,mSelectPt2).normalized();
+		beginUpdate();
 		cells().selectCells(r);
-		update();
+		endUpdate();
 	}
 }
 
@@ -85,22 +437,480 @@ void CScreen::setDefaultBackgroundColor(QColor defaultBackgroundColor)
 	setPalette(p);
 	setAutoFillBackground(true);
 	mDefaultBackgroundColor=defaultBackgroundColor;
+	invalidate();
 }
 
 void CScreen::setDefaultForegroundColor(QColor defaultForegroundColor)
 {
 	mDefaultForegroundColor=defaultForegroundColor;
+	invalidate();
 }
 
-void CScreen::setBackgroundColor(QColor backgroundColor)
+/** change a palette entry, the cells refer to it by index so only the frame is redrawn */
+void CScreen::setPaletteColor(int n, QColor color)
+{
+	cells().styles().setPaletteColor(n,color.rgb());
+	invalidate();
+}
+
+void CScreen::resetPalette(int n)
 {
-	mBackgroundColor=backgroundColor;
+	cells().styles().resetPalette(n);
+	invalidate();
 }
 
+/** switch to the current rendition with another background, the default background follows the screen */
+void CScreen::setBackgroundColor(QColor backgroundColor)
+{
+	QRgb bg = ( backgroundColor == defaultBackgroundColor() ) ? CStyleTable::defaultColor : backgroundColor.rgb();
+	mStyleId = cells().styles().withBackground(mStyleId,bg);
+}
 
+/** switch to the current rendition with another foreground, the default foreground follows the screen */
 void CScreen::setForegroundColor(QColor foregroundColor)
 {
-	mForegroundColor=foregroundColor;
+	QRgb fg = ( foregroundColor == defaultForegroundColor() ) ? CStyleTable::defaultColor : foregroundColor.rgb();
+	mStyleId = cells().styles().withForeground(mStyleId,fg);
+}
+
+/** Defer repaints until the matching endUpdate() */
+void CScreen::beginUpdate()
+{
+	++mUpdateDepth;
+}
+
+/** Issue the repaints deferred since the outermost beginUpdate() */
+void CScreen::endUpdate()
+{
+	if ( mUpdateDepth > 0 && --mUpdateDepth == 0 )
+	{
+		flushDamage();
+		updateScrollBar();
+	}
+}
+
+/** Re-render the cells under a rectangle, the repaint is deferred while updating */
+void CScreen::invalidate(const QRect& r)
+{
+	int w = cells().cellWidth();
+	int h = cells().cellHeight();
+	if ( w <= 0 || h <= 0 )
+	{
+		mDamageAll = true;
+	}
+	else
+	{
+		int firstCol = (r.left()-cells().rect().left())/w;
+		int lastCol = (r.right()-cells().rect().left())/w;
+		int firstRow = (r.top()-cells().rect().top())/h;
+		int lastRow = (r.bottom()-cells().rect().top())/h;
+		for( int row=firstRow; row <= lastRow; row++ )
+		{
+			damage(firstCol,row,(lastCol-firstCol)+1);
+		}
+	}
+	if ( mUpdateDepth == 0 )
+	{
+		flushDamage();
+	}
+}
+
+/** Re-render the whole screen, the repaint is deferred while updating */
+void CScreen::invalidate()
+{
+	mDamageAll = true;
+	if ( mUpdateDepth == 0 )
+	{
+		requestFrame();
+	}
+}
+
+/** Re-render count cells of a row */
+void CScreen::invalidateSpan(int col,int row,int count)
+{
+	damage(col,row,count);
+	if ( mUpdateDepth == 0 )
+	{
+		flushDamage();
+	}
+}
+
+/** Re-render count whole rows */
+void CScreen::invalidateRows(int row,int count)
+{
+	for( int n=0; n < count; n++ )
+	{
+		damage(0,row+n,cols());
+	}
+	if ( mUpdateDepth == 0 )
+	{
+		flushDamage();
+	}
+}
+
+/** Repaint the cursor cell, the cursor is drawn over the backing store so no cells are re-rendered */
+void CScreen::updateCursor()
+{
+	if ( mUpdateDepth == 0 )
+	{
+		requestFrame(cursorRect(mCursor));
+	}
+	else
+	{
+		mCursorDamaged = true;
+	}
+}
+
+/** where the cursor at pt is drawn, below the history shown */
+QRect CScreen::cursorRect(const QPoint& pt)
+{
+	return cells().cellRect(pt.x(),pt.y()+viewOffset());
+}
+
+/**
+ * @brief Full-width rows are about to move. Without jump scroll the scroll recorded before this
+ * @brief one is rendered now, while the cells still match it, and shown before returning so every
+ * @brief line is seen.
+ */
+void CScreen::aboutToScroll()
+{
+	if ( !mJumpScroll && mUpdateDepth > 0 && viewOffset() == 0 && ( mScrollLines != 0 || mScrollJumped || mDamageAll ) )
+	{
+		renderBacking();
+		mFrameAll = true;
+		issueFrame(true);
+	}
+}
+
+/**
+ * @brief Full-width rows top..top+height-1 moved lines rows up (down when negative).
+ * @brief The backing store is shifted by the same amount when it is next painted, so only the
+ * @brief rows that scrolled in are re-rendered. Scrolls of the same region accumulate.
+ * @brief Once a screenful has scrolled the region is rendered once in its final state and further
+ * @brief scrolls cost nothing here (jump scroll). Without jump scroll aboutToScroll() has painted
+ * @brief the previous line already.
+ */
+void CScreen::scrollRows(int top,int height,int lines)
+{
+	if ( height <= 0 || lines == 0 )
+	{
+		return;
+	}
+	if ( viewOffset() > 0 )
+	{
+		/* the view is in history, the screen rows are not where they are drawn */
+		invalidate();
+		return;
+	}
+	if ( mScrollJumped && top == mScrollTop && height == mScrollHeight )
+	{
+		return;
+	}
+	if ( !mDamageAll && mScrollLines != 0 && ( top != mScrollTop || height != mScrollHeight ) )
+	{
+		/* a second region, give up blitting the first one */
+		invalidateRows(mScrollTop,mScrollHeight);
+		mScrollLines = 0;
+	}
+	if ( mDamageAll )
+	{
+		return;
+	}
+	syncDamage();
+	mScrollTop = top;
+	mScrollHeight = height;
+	mScrollJumped = false;
+	mScrollLines += lines;
+	if ( qAbs(mScrollLines) >= height )
+	{
+		/* everything in the region scrolled away, nothing to blit */
+		mScrollLines = 0;
+		invalidateRows(top,height);
+		mScrollJumped = true;
+		return;
+	}
+	/* damage not rendered yet moves with the rows, the rows scrolled in are blank */
+	int* first = mDamageFirst.data()+top;
+	int* last = mDamageLast.data()+top;
+	int n = qAbs(lines);
+	if ( lines > 0 )
+	{
+		std::rotate(first,first+n,first+height);
+		std::rotate(last,last+n,last+height);
+	}
+	else
+	{
+		std::rotate(first,first+height-n,first+height);
+		std::rotate(last,last+height-n,last+height);
+	}
+	for( int row = ( lines > 0 ) ? top+height-n : top; n > 0; --n, ++row )
+	{
+		mDamageFirst[row] = -1;
+		damage(0,row,cols());
+	}
+	if ( mUpdateDepth == 0 )
+	{
+		requestFrame(cells().rowsRect(top,height));
+	}
+}
+
+/** Size the damage record to the grid, a resize damages everything */
+void CScreen::syncDamage()
+{
+	if ( mDamageFirst.count() != rows() )
+	{
+		mDamageFirst.fill(-1,rows());
+		mDamageLast.fill(-1,rows());
+		mDamageAll = true;
+	}
+}
+
+/** Record that count cells of a row must be re-rendered */
+void CScreen::damage(int col,int row,int count)
+{
+	syncDamage();
+	if ( viewOffset() > 0 )
+	{
+		mDamageAll = true;
+	}
+	if ( mDamageAll )
+	{
+		return;
+	}
+	int last = qMin(col+count,cols())-1;
+	col = qMax(col,0);
+	if ( row < 0 || row >= rows() || last < col )
+	{
+		return;
+	}
+	int& first = mDamageFirst[row];
+	if ( first < 0 )
+	{
+		first = col;
+		mDamageLast[row] = last;
+	}
+	else
+	{
+		first = qMin(first,col);
+		mDamageLast[row] = qMax(mDamageLast[row],last);
+	}
+	mDamaged = true;
+}
+
+/**
+ * @brief The damaged cells as a region.
+ * @brief Consecutive rows damaged over the same columns become a single rectangle.
+ */
+QRegion CScreen::damageRegion()
+{
+	QRegion region;
+	int row=0;
+	while ( mDamaged && row < mDamageFirst.count() )
+	{
+		int first = mDamageFirst[row];
+		if ( first < 0 )
+		{
+			++row;
+			continue;
+		}
+		int last = mDamageLast[row];
+		int top = row;
+		while ( row < mDamageFirst.count() && mDamageFirst[row] == first && mDamageLast[row] == last )
+		{
+			++row;
+		}
+		QRect r = cells().spanRect(first,top,(last-first)+1);
+		r.setHeight((row-top)*cells().cellHeight());
+		region += r;
+	}
+	return region;
+}
+
+/** Request one frame for everything damaged while updating */
+void CScreen::flushDamage()
+{
+	if ( mDamageAll )
+	{
+		requestFrame();
+	}
+	else
+	{
+		QRegion region = damageRegion();
+		if ( mScrollLines != 0 )
+		{
+			region += cells().rowsRect(mScrollTop,mScrollHeight);
+		}
+		if ( mCursorDamaged )
+		{
+			region += cursorRect(mPaintedCursor);
+			region += cursorRect(mCursor);
+		}
+		if ( !region.isEmpty() )
+		{
+			requestFrame(region);
+		}
+	}
+	mCursorDamaged = false;
+}
+
+/** Cap repaints to fps frames per second, 0 follows the display refresh rate */
+void CScreen::setFrameRate(int fps)
+{
+	mFrameRate = qMax(fps,0);
+}
+
+/** Milliseconds between frames */
+int CScreen::frameInterval()
+{
+	qreal fps = mFrameRate;
+	if ( fps <= 0 )
+	{
+		fps = CSCREEN_DEFAULT_FRAME_RATE;
+#if QT_VERSION >= 0x050000
+		if ( QGuiApplication::primaryScreen() != NULL && QGuiApplication::primaryScreen()->refreshRate() > 0 )
+		{
+			fps = QGuiApplication::primaryScreen()->refreshRate();
+		}
+#endif
+	}
+	return qMax(qRound(1000.0/fps),1);
+}
+
+/**
+ * @brief Paint the next frame as soon as something changes, used for the echo of a key press.
+ * @brief A frame already waiting on the frame cap is issued now.
+ */
+void CScreen::requestImmediateFrame()
+{
+	mImmediateFrame = true;
+	if ( mFrameAll || !mFrameRegion.isEmpty() )
+	{
+		issueFrame();
+	}
+}
+
+/**
+ * @brief Add region to the next frame.
+ * @brief The frame is issued now unless one was issued less than a frame interval ago, in which case
+ * @brief the frame timer issues it when the interval is up and repaints accumulate until then.
+ */
+void CScreen::requestFrame(const QRegion& region)
+{
+	mFrameRegion += region;
+	if ( mFrameTimer < 0 )
+	{
+		int wait = frameInterval() - ( mFrameClock.isValid() ? (int)qMin(mFrameClock.elapsed(),(qint64)INT_MAX) : INT_MAX );
+		if ( mImmediateFrame || wait <= 0 )
+		{
+			issueFrame();
+		}
+		else
+		{
+			mFrameTimer = startTimer(wait);
+		}
+	}
+}
+
+/** Add the whole screen to the next frame */
+void CScreen::requestFrame()
+{
+	mFrameAll = true;
+	requestFrame(QRegion());
+}
+
+/** Repaint what the frame collected, now paints before returning */
+void CScreen::issueFrame(bool now)
+{
+	if ( mFrameTimer >= 0 )
+	{
+		killTimer(mFrameTimer);
+		mFrameTimer = -1;
+	}
+	QRegion region = mFrameAll ? QRegion(rect()) : mFrameRegion;
+	if ( !region.isEmpty() )
+	{
+		if ( now )
+		{
+			repaint(region);
+		}
+		else
+		{
+			update(region);
+		}
+	}
+	mFrameRegion = QRegion();
+	mFrameAll = false;
+	mImmediateFrame = false;
+	mFrameClock.restart();
+}
+
+/** Shift the backing store by the pending scroll */
+void CScreen::applyScroll()
+{
+	int h = cells().cellHeight();
+	int top = cells().rect().top()+(mScrollTop*h);
+	int height = qMin(mScrollHeight*h,mBacking.height()-top);
+	int shift = qAbs(mScrollLines)*h;
+	if ( top >= 0 && shift < height )
+	{
+		int bpl = mBacking.bytesPerLine();
+		uchar* bits = mBacking.scanLine(top);
+		if ( mScrollLines > 0 )
+		{
+			memmove(bits,bits+(shift*bpl),(height-shift)*bpl);
+		}
+		else
+		{
+			memmove(bits+(shift*bpl),bits,(height-shift)*bpl);
+		}
+	}
+	mScrollLines = 0;
+}
+
+/** Bring the backing store up to date with the cells */
+void CScreen::renderBacking()
+{
+	if ( mBacking.size() != size() )
+	{
+		mBacking = QImage(size(),QImage::Format_ARGB32_Premultiplied);
+		mDamageAll = true;
+	}
+	syncDamage();
+	if ( mDamageAll )
+	{
+		mBacking.fill(reverseScreen() ? defaultForegroundColor() : defaultBackgroundColor());
+		QPainter painter(&mBacking);
+		cells().draw(painter,mBacking.rect());
+		mScrollLines = 0;
+	}
+	else
+	{
+		if ( mScrollLines != 0 )
+		{
+			applyScroll();
+		}
+		if ( mDamaged )
+		{
+			QRegion region = damageRegion();
+			QPainter painter(&mBacking);
+#if QT_VERSION >= 0x050800
+			for( QRegion::const_iterator r=region.begin(); r != region.end(); ++r )
+			{
+				cells().draw(painter,*r);
+			}
+#else
+			QVector<QRect> rects = region.rects();
+			for( int n=0; n < rects.count(); n++ )
+			{
+				cells().draw(painter,rects.at(n));
+			}
+#endif
+		}
+	}
+	mDamageFirst.fill(-1);
+	mDamaged = false;
+	mDamageAll = false;
+	mScrollJumped = false;
 }
 
 /** Return the selected text as a string object */
@@ -132,82 +942,116 @@ void CScreen::setCursorPos(QPoint& pt)
 
 void CScreen::setCursorPos(int col,int row)
 {
-	if ( cells().indexOf(col,row) < cells().count() )
+	if ( cells().isValidCell(col,row) )
 	{
-		CCharCell& oldCell = cell(mCursor.x(),mCursor.y());
-		CCharCell& newCell = cell(col,row);
-		oldCell.setCursor(false);
-		newCell.setCursor(true);
+		updateCursor();
 		mCursor.setX(col);
 		mCursor.setY(row);
+		mCursorState = true;
+		updateCursor();
 	}
 }
 
-/** Clear from the current cursor position to the end of the line */
-void CScreen::clearEOL()
+/** Blank count cells of a row in a style, one fill and one damage record */
+void CScreen::fillSpan(int col,int row,int count,quint16 style)
 {
-	for( int n=cursorPos().x(); n < cols(); n++ )
+	cells().fillSpan(col,row,count,CCharCell(' ',style));
+	invalidateSpan(col,row,count);
+	if ( cells().styles().blink(style) )
 	{
-		cell(n,cursorPos().y()).clear();
+		updateBlinkTimer();
 	}
 }
 
-/** Clear from the current cursor position to the beginning of the line */
-void CScreen::clearBOL()
+/** Blank count whole rows in a style */
+void CScreen::fillRows(int row,int count,quint16 style)
 {
-	for( int n=cursorPos().x(); n >= 0; n-- )
+	cells().fillRows(row,count,CCharCell(' ',style));
+	if ( row <= 0 && row+count >= rows() )
+	{
+		invalidate();
+	}
+	else
 	{
-		cell(n,cursorPos().y()).clear();
+		invalidateRows(row,count);
+	}
+	if ( cells().styles().blink(style) )
+	{
+		updateBlinkTimer();
 	}
 }
 
-/** Clear from the current cursor position to the end of display */
-void CScreen::clearEOD()
+/** Blank a rectangle of cells in a style */
+void CScreen::fillRect(const QRect& r,quint16 style)
 {
-	clearEOL();
-	for( int y=cursorPos().y()+1; y < rows(); y++ )
+	QRect cr = r.intersected(QRect(0,0,cols(),rows()));
+	cells().fillRect(cr,CCharCell(' ',style));
+	invalidate(cells().spanRect(cr.left(),cr.top(),cr.width()).united(cells().spanRect(cr.left(),cr.bottom(),cr.width())));
+	if ( cells().styles().blink(style) )
 	{
-		for( int x=0; x < cols(); x++ )
-		{
-			cell(x,y).clear();
-		}
+		updateBlinkTimer();
 	}
 }
 
+/** Erased cells take the current background with no attributes */
+quint16 CScreen::eraseStyle()
+{
+	return cells().styles().intern(CStyleTable::defaultColor,cells().styles().background(styleId()),0);
+}
+
+/** Clear from the current cursor position to the end of the line */
+void CScreen::clearEOL()
+{
+	fillSpan(cursorPos().x(),cursorPos().y(),cols()-cursorPos().x(),eraseStyle());
+}
+
+/** Clear from the current cursor position to the beginning of the line */
+void CScreen::clearBOL()
+{
+	fillSpan(0,cursorPos().y(),cursorPos().x()+1,eraseStyle());
+}
+
+/** Clear from the current cursor position to the end of display */
+void CScreen::clearEOD()
+{
+	beginUpdate();
+	clearEOL();
+	fillRows(cursorPos().y()+1,rows()-(cursorPos().y()+1),eraseStyle());
+	endUpdate();
+}
 
 /** Clear from the beginning of display to current cursor position */
 void CScreen::clearBOD()
 {
-	for( int y=0; y < cursorPos().y(); y++ )
-	{
-		for( int x=0; x < cols(); x++ )
-		{
-			cell(x,y).clear();
-		}
-	}
+	beginUpdate();
+	fillRows(0,cursorPos().y(),eraseStyle());
 	clearBOL();
+	endUpdate();
 }
 
 /** Clear the entire screen */
 void CScreen::clear()
 {
 	setCursorPos(0,0);
-	clearEOD();
+	fillRows(0,rows(),eraseStyle());
 }
 
-/** Delete n chars from cursor position */
+/** Delete n chars from cursor position, the rest of the line moves left */
 void CScreen::delChars(int num)
 {
-	for( int n=0; n < num; n++)
-	{
-		for( int x=cursorPos().x(); x < cols()-1; x++ )
-		{
-			CCharCell& from = cell(x+1,cursorPos().y());
-			cell(x,cursorPos().y()).copy(from);
-		}
-		cell(cols()-1,cursorPos().y()).clear();
-	}
-	cells().sync();
+	int x = cursorPos().x();
+	int y = cursorPos().y();
+	num = qBound(0,num,cols()-x);
+	CCharCell* line = cells().line(y);
+	memmove(line+x,line+x+num,(cols()-(x+num))*sizeof(CCharCell));
+	cells().fillSpan(cols()-num,y,num,CCharCell(' ',eraseStyle()));
+	invalidateSpan(x,y,cols()-x);
+}
+
+/** Blank num cells from the cursor, the cursor does not move */
+void CScreen::eraseChars(int num)
+{
+	fillSpan(cursorPos().x(),cursorPos().y(),qMax(num,1),eraseStyle());
 }
 
 /** Insert n lines */
@@ -215,20 +1059,8 @@ void CScreen::insLines(int num)
 {
 	for( int n=0; n < num; n++)
 	{
-		for( int y=rows()-1; y > cursorPos().y(); y--)
-		{
-			for( int x=0; x < cols(); x++ )
-			{
-				CCharCell& from = cell(x,y-1);
-				cell(x,y).copy(from);
-			}
-		}
-		for( int x=0; x < cols(); x++)
-		{
-			cell(x,cursorPos().y()).clear();
-		}
+		cells().scrollGrid(CCellArray::ScrollDown,0,cursorPos().y(),cols(),rows()-cursorPos().y());
 	}
-	cells().sync();
 }
 
 /** Put a character */
@@ -236,10 +1068,38 @@ void CScreen::putchar(char c,int x, int y)
 {
 	if ( x < 0 ) x = cursorPos().x();
 	if ( y < 0 ) y = cursorPos().y();
-	cell(x,y).setCharacter(c);
-	cell(x,y).setBackgroundColor(backgroundColor());
-	cell(x,y).setForegroundColor(foregroundColor());
-	cell(x,y).setReverse(this->reverse());
+	cell(x,y) = CCharCell((unsigned char)c,styleId());
+	invalidateSpan(x,y,1);
+	if ( blink() )
+	{
+		cells().markBlink(y);
+		updateBlinkTimer();
+	}
+}
+
+/**
+ * @brief Write a run of characters at the cursor with the current attributes.
+ * @brief The cursor is not moved and the run is clipped at the end of the line.
+ * @return The number of characters written.
+ */
+int CScreen::putRun(const char* s,int len)
+{
+	int x = cursorPos().x();
+	int y = cursorPos().y();
+	int count = qMin(len,cols()-x);
+	quint16 style = styleId();
+	CCharCell* cells = this->cells().line(y)+x;
+	for( int n=0; n < count; n++ )
+	{
+		cells[n] = CCharCell((unsigned char)s[n],style);
+	}
+	invalidateSpan(x,y,count);
+	if ( blink() )
+	{
+		this->cells().markBlink(y);
+		updateBlinkTimer();
+	}
+	return count;
 }
 
 /** advance the cursor and scroll if we need to */
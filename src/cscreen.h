@@ -26,36 +26,70 @@
 #include <QPoint>
 #include <QColor>
 #include <QMouseEvent>
+#include <QRegion>
+#include <QImage>
+#include <QVector>
+#include <QTimerEvent>
+#include <QElapsedTimer>
+#include <QScrollBar>
+#include <QWheelEvent>
 
 #include "ccellarray.h"
+#include "cscrollback.h"
+
+#define CSCREEN_BLINK_MSEC		500		/* blink clock period, the cursor toggles every tick */
+#define CSCREEN_TEXT_BLINK_TICKS	2		/* blinking text toggles every this many ticks */
+#define CSCREEN_DEFAULT_FRAME_RATE	60		/* frames per second when the display refresh rate is unknown */
+#define CSCREEN_BELL_MSEC		100		/* how long a visual bell shows the screen inverted */
 
 class CScreen : public QWidget
 {
 	Q_OBJECT
 	public:
+
+		typedef enum
+		{
+			CursorUnderline,
+			CursorBlockOutline,
+			CursorBlockInvert
+		} CursorStyle;
+
 		CScreen(QWidget *parent = 0);
 		virtual ~CScreen();
 
 		CCellArray&		cells()										{return mCells;}
-		inline CCharCell& cell(int col,int row)						{return (CCharCell&)cells().cell(col,row);}
+		CScrollback&	scrollback()								{return mScrollback;}
+		inline int		viewOffset()								{return cells().viewOffset();}	/** history lines shown, 0 for the live screen */
+		inline CCharCell& cell(int col,int row)						{return cells().cell(col,row);}
 		inline CCharCell& cell(QPoint pt)							{return cell(pt.x(),pt.y());}
 
 		inline QPoint&	cursorPos()									{return mCursor;}
+		inline CursorStyle cursorStyle()							{return mCursorStyle;}
+		inline bool		cursorVisible()								{return mCursorVisible;}
+		inline bool		blinkState()								{return mBlinkState;}		/** true while blinking text is shown */
+		inline int		frameRate()									{return mFrameRate;}		/** frame cap, 0 follows the display */
+		inline bool		jumpScroll()								{return mJumpScroll;}		/** false to paint every scrolled line */
+		inline bool		alternateScreen()							{return cells().alternate();}	/** the alternate screen is shown */
+		inline bool		reverseScreen()								{return mReverseScreen;}	/** default colors swapped for the whole screen */
 
 		inline int		cols()										{return cells().cols();}
 		inline int		rows()										{return cells().rows();}
 
 		inline QColor&	defaultForegroundColor()					{return mDefaultForegroundColor;}
 		inline QColor&	defaultBackgroundColor()					{return mDefaultBackgroundColor;}
-		inline QColor&	foregroundColor()							{return mForegroundColor;}
-		inline QColor&	backgroundColor()							{return mBackgroundColor;}
+		inline QColor	paletteColor(int n)							{return QColor::fromRgb(cells().styles().paletteColor(n));}	/** an entry of the 256 color palette */
+		inline QColor	foregroundColor()							{return cells().foregroundColor(mStyleId);}
+		inline QColor	backgroundColor()							{return cells().backgroundColor(mStyleId);}
 
-		inline bool		blink()										{return mBlink;}
-		inline bool		bold()										{return mBold;}
-		inline bool		reverse()									{return mReverse;}
-		inline bool		underline()									{return mUnderline;}
+		inline bool		blink()										{return cells().styles().blink(mStyleId);}
+		inline bool		bold()										{return cells().styles().bold(mStyleId);}
+		inline bool		reverse()									{return cells().styles().reverse(mStyleId);}
+		inline bool		underline()									{return cells().styles().underline(mStyleId);}
+		inline quint16	styleId()									{return mStyleId;}			/** style id of the current rendition */
 
 		QString			selectedText();
+		bool			pageKey(QKeyEvent* e);						/** page through history on Shift+PgUp/PgDn/Home/End, true when handled */
+		bool			find(const QString& text, bool backward);	/** find text in history and on the screen from the last match, false when none */
 
 	public slots:
 
@@ -63,11 +97,27 @@ class CScreen : public QWidget
 		void			setDefaultForegroundColor(QColor defaultForegroundColor);
 		void			setBackgroundColor(QColor backgroundColor);
 		void			setForegroundColor(QColor foregroundColor);
-
-		inline void		setBlink(bool b)							{mBlink=b;}
-		inline void		setBold(bool b)								{mBold=b;}
-		inline void		setReverse(bool b)							{mReverse=b;}
-		inline void		setUnderline(bool b)						{mUnderline=b;}
+		void			setPaletteColor(int n, QColor color);		/** change a palette entry, cells using it are recolored */
+		void			resetPalette(int n=-1);						/** back to the default palette, one entry or all of them */
+		inline void		setForeground(QRgb color)					{mStyleId=cells().styles().withForeground(mStyleId,color);}	/** a style table color, default, indexed or direct */
+		inline void		setBackground(QRgb color)					{mStyleId=cells().styles().withBackground(mStyleId,color);}
+
+		void			setCursorStyle(CursorStyle cs);
+		void			setCursorVisible(bool b);
+		void			setFrameRate(int fps);						/** cap repaints to fps frames per second, 0 follows the display */
+		void			requestImmediateFrame();					/** paint the next frame without waiting for the frame cap */
+		inline void		setJumpScroll(bool b)						{mJumpScroll=b;}
+		void			setViewOffset(int lines);					/** show lines of history above the screen, 0 for the live screen */
+		void			setAlternateScreen(bool b, bool clear=false);	/** show the alternate screen, clear blanks it on the way in or out */
+		void			setReverseScreen(bool b);					/** draw every cell reversed */
+		void			visualBell();								/** flash the screen inverted for a moment */
+		void			showLine(int line);							/** bring a line into view, lines count from the oldest in history */
+		void			clearFind();								/** forget the last match */
+		inline void		setStyleId(quint16 id)						{mStyleId=id;}				/** switch the current rendition, 0 for the defaults */
+		inline void		setBlink(bool b)							{mStyleId=cells().styles().withAttribute(mStyleId,CStyleTable::attrBlink,b);}
+		inline void		setBold(bool b)								{mStyleId=cells().styles().withAttribute(mStyleId,CStyleTable::attrBold,b);}
+		inline void		setReverse(bool b)							{mStyleId=cells().styles().withAttribute(mStyleId,CStyleTable::attrReverse,b);}
+		inline void		setUnderline(bool b)						{mStyleId=cells().styles().withAttribute(mStyleId,CStyleTable::attrUnderline,b);}
 
 		inline void		setGrid(int cols,int rows)					{setCols(cols); setRows(rows);}
 		inline void		setCols(int cols)							{cells().setCols(cols);}
@@ -77,6 +127,11 @@ class CScreen : public QWidget
 		void			scrollUp();
 		void			scrollDown();
 
+		void			fillSpan(int col,int row,int count,quint16 style=0);	/** blank count cells of a row in a style */
+		void			fillRows(int row,int count,quint16 style=0);		/** blank count whole rows in a style */
+		void			fillRect(const QRect& r,quint16 style=0);			/** blank a rectangle of cells in a style */
+		quint16			eraseStyle();								/** style of erased cells, the current background */
+
 		void			clear();
 		void			clearEOL();
 		void			clearBOL();
@@ -84,33 +139,91 @@ class CScreen : public QWidget
 		void			clearBOD();
 
 		void			delChars(int num);
+		void			eraseChars(int num);						/** blank num cells from the cursor, ECH */
 		void			insLines(int num);
 
 		void			putchar(char c,int x=-1,int y=-1);
 		inline void		putchar(char c,QPoint pt)					{putchar(c,pt.x(),pt.y());}
+		int				putRun(const char* s,int len);				/** write a run at the cursor up to the end of the line */
 
 		bool			advanceCursor();
 
+		void			beginUpdate();								/** defer repaints until the matching endUpdate() */
+		void			endUpdate();								/** issue the repaints deferred since beginUpdate() */
+		void			invalidate(const QRect& r);					/** repaint r, deferred while updating */
+		void			invalidate();								/** repaint the whole screen, deferred while updating */
+		void			invalidateSpan(int col,int row,int count);	/** repaint count cells of a row */
+		void			invalidateRows(int row,int count);			/** repaint count whole rows */
+		void			aboutToScroll();							/** full-width rows are about to move, smooth scroll paints the last move */
+		void			scrollRows(int top,int height,int lines);	/** full-width rows moved lines up, down when negative */
+
 	protected:
 		void			resizeEvent(QResizeEvent* e);
 		void			paintEvent(QPaintEvent* e);
 		void			mousePressEvent(QMouseEvent *e);
 		void			mouseMoveEvent(QMouseEvent *e);
 		void			mouseReleaseEvent(QMouseEvent *e);
+		void			timerEvent(QTimerEvent* e);
+		void			wheelEvent(QWheelEvent* e);
+		void			drawCursor(QPainter& painter);
+		void			updateBlinkTimer();
+		void			invalidateBlinking();
+		void			updateCursor();
+		QRect			cursorRect(const QPoint& pt);
+		void			updateScrollBar();
+		void			syncDamage();
+		void			damage(int col,int row,int count);
+		QRegion			damageRegion();
+		void			flushDamage();
+		int				frameInterval();
+		void			requestFrame(const QRegion& region);
+		void			requestFrame();
+		void			issueFrame(bool now=false);
+		void			applyScroll();
+		void			renderBacking();
+
+	private slots:
+		void			scrollTo(int value);
 
 	private:
 		CCellArray		mCells;
+		CScrollback		mScrollback;								/** lines scrolled off the top */
+		QScrollBar*		mScrollBar;									/** history position, the bottom is the live screen */
 		QPoint			mCursor;
+		CursorStyle		mCursorStyle;
+		bool			mCursorVisible;								/** cursor enabled */
+		bool			mCursorState;								/** cursor blink phase, true when shown */
+		int				mBlinkTimer;								/** the one blink clock for the cursor and text, -1 when idle */
+		int				mBlinkTicks;								/** ticks since the text blink phase changed */
+		bool			mBlinkState;								/** text blink phase, true when shown */
+		quint16			mStyleId;									/** style id of the current colors and attributes */
 		QColor			mDefaultBackgroundColor;
 		QColor			mDefaultForegroundColor;
-		QColor			mBackgroundColor;
-		QColor			mForegroundColor;
-		bool			mBlink;
-		bool			mBold;
-		bool			mReverse;
-		bool			mUnderline;
 		QPoint			mSelectPt1;
 		QPoint			mSelectPt2;
+		int				mUpdateDepth;								/** beginUpdate() nesting */
+		QVector<int>	mDamageFirst;								/** by row, first damaged column while updating, -1 when clean */
+		QVector<int>	mDamageLast;								/** by row, last damaged column while updating */
+		bool			mDamaged;									/** some row is damaged */
+		bool			mDamageAll;									/** the whole screen is damaged */
+		bool			mCursorDamaged;								/** the cursor moved or blinked while updating */
+		QPoint			mPaintedCursor;								/** where the cursor was last drawn */
+		QImage			mBacking;									/** the rendered cells, the cursor is drawn over it */
+		int				mScrollTop;									/** first row of the pending scroll */
+		int				mScrollHeight;								/** rows in the pending scroll */
+		int				mScrollLines;								/** pending scroll, positive is up */
+		bool			mScrollJumped;								/** the pending scroll region is re-rendered whole */
+		bool			mJumpScroll;								/** false to paint every scrolled line */
+		int				mFrameRate;									/** frame cap, 0 follows the display */
+		int				mFrameTimer;								/** fires when the next frame is due, -1 when idle */
+		QElapsedTimer	mFrameClock;								/** time since the last frame was issued */
+		QRegion			mFrameRegion;								/** repaint requested for the next frame */
+		bool			mFrameAll;									/** the next frame repaints the whole screen */
+		bool			mImmediateFrame;							/** issue the next frame without waiting */
+		int				mFindLine;									/** line of the last match, -1 for none */
+		int				mFindCol;
+		bool			mReverseScreen;								/** cells are drawn reversed */
+		int				mBellTimer;									/** ends the visual bell, -1 when not flashing */
 };
 
 #endif // CSCREEN_H
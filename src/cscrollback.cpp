@@ -0,0 +1,531 @@
+/**************************************************************************
+*   Author <mike@pikeaero.com> Mike Sharkey                               *
+*   Copyright (C) 2010 by Pike Aerospace Research Corporation             *
+*                                                                         *
+*   This program is free software: you can redistribute it and/or modify  *
+*   it under the terms of the GNU General Public License as published by  *
+*   the Free Software Foundation, either version 3 of the License, or     *
+*   (at your option) any later version.                                   *
+*                                                                         *
+*   This program is distributed in the hope that it will be useful,       *
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+*   GNU General Public License for more details.                          *
+*                                                                         *
+*   You should have received a copy of the GNU General Public License     *
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+**************************************************************************/
+#include "cscrollback.h"
+
+#include <QtAlgorithms>
+#include <QDir>
+#include <QTemporaryFile>
+#include <QChar>
+#if QT_VERSION >= 0x050000
+#include <QStandardPaths>
+#else
+#include <QDesktopServices>
+#endif
+#include <string.h>
+#include <limits.h>
+#include <algorithm>
+
+CScrollback::CScrollback()
+: mFirst(0)
+, mLines(0)
+, mLimit(CSCROLLBACK_DEFAULT_LINES)
+, mMemoryLimit(CSCROLLBACK_DEFAULT_MEMORY)
+, mPackedBytes(0)
+, mSpilledBlocks(0)
+, mSpill(NULL)
+, mSpillFailed(false)
+, mSpillEnd(0)
+{
+}
+
+CScrollback::~CScrollback()
+{
+	clear();
+}
+
+/** drop all lines */
+void CScrollback::clear()
+{
+	qDeleteAll(mBlocks);
+	mBlocks.clear();
+	mUnpacked.clear();
+	mFirst = 0;
+	mLines = 0;
+	mPackedBytes = 0;
+	mSpilledBlocks = 0;
+	closeSpill();
+}
+
+/**
+ * @brief Set the number of lines kept, the oldest lines beyond it are dropped.
+ */
+void CScrollback::setLimit(int lines)
+{
+	mLimit = qMax(lines,0);
+	trim();
+}
+
+/**
+ * @brief Set the MB of compressed blocks kept in memory, older blocks go to the spill file.
+ */
+void CScrollback::setMemoryLimit(int mb)
+{
+	mMemoryLimit = qMax(mb,0);
+	spill();
+}
+
+/**
+ * @brief The block holding line n.
+ * @param index Set to the line within the block.
+ */
+CScrollback::Block* CScrollback::block(int n, int& index)
+{
+	n += mFirst;
+	index = n % CSCROLLBACK_BLOCK_LINES;
+	Block* b = mBlocks.at(n / CSCROLLBACK_BLOCK_LINES);
+	if ( !b->packed.isEmpty() || b->offset >= 0 )
+	{
+		unpack(b);
+	}
+	return b;
+}
+
+/** blocks held compressed */
+int CScrollback::compressedBlocks()
+{
+	int count=0;
+	for( int n=0; n < mBlocks.count(); n++ )
+	{
+		if ( !mBlocks.at(n)->packed.isEmpty() || mBlocks.at(n)->offset >= 0 )
+		{
+			++count;
+		}
+	}
+	return count;
+}
+
+/**
+ * @brief Compress a full block and free its cells.
+ * @brief The line ends go first, then the cells, both in host order.
+ */
+void CScrollback::pack(Block* b)
+{
+	QByteArray raw;
+	raw.append((const char*)b->ends.constData(),b->ends.count()*sizeof(int));
+	raw.append((const char*)b->cells.constData(),b->cells.count()*sizeof(CCharCell));
+	b->packed = qCompress(raw);
+	b->size = b->packed.size();
+	b->styles.clear();
+	for( int n=0; n < b->cells.count(); n++ )
+	{
+		quint16 style = b->cells.at(n).style();
+		if ( b->styles.isEmpty() || b->styles.last() != style )
+		{
+			b->styles.append(style);
+		}
+	}
+	std::sort(b->styles.begin(),b->styles.end());
+	b->styles.erase(std::unique(b->styles.begin(),b->styles.end()),b->styles.end());
+	mPackedBytes += b->size;
+	unload(b);
+	spill();
+}
+
+/**
+ * @brief Make the cells of a compressed block readable.
+ * @brief The block becomes the most recently read one, the least recently read is unloaded once
+ * @brief more than CSCROLLBACK_CACHE_BLOCKS are unpacked.
+ */
+void CScrollback::unpack(Block* b)
+{
+	int at = mUnpacked.indexOf(b);
+	if ( at == 0 )
+	{
+		return;
+	}
+	if ( at > 0 )
+	{
+		mUnpacked.move(at,0);
+		return;
+	}
+	QByteArray raw;
+	if ( b->offset >= 0 )
+	{
+		uchar* data = ( mSpill != NULL ) ? mSpill->map(b->offset,b->size) : NULL;
+		if ( data != NULL )
+		{
+			raw = qUncompress(data,b->size);
+			mSpill->unmap(data);
+		}
+	}
+	else
+	{
+		raw = qUncompress(b->packed);
+	}
+	int endsSize = b->lines*sizeof(int);
+	if ( raw.size() < endsSize )
+	{
+		/* unreadable, the lines come back empty */
+		b->ends.fill(0,b->lines);
+		b->cells.clear();
+	}
+	else
+	{
+		b->ends.resize(b->lines);
+		memcpy(b->ends.data(),raw.constData(),endsSize);
+		b->cells.resize(b->lines > 0 ? b->ends.last() : 0);
+		memcpy(b->cells.data(),raw.constData()+endsSize,b->cells.count()*sizeof(CCharCell));
+	}
+	mUnpacked.prepend(b);
+	while ( mUnpacked.count() > CSCROLLBACK_CACHE_BLOCKS )
+	{
+		unload(mUnpacked.takeLast());
+	}
+}
+
+/**
+ * @brief Move the oldest compressed blocks to the spill file until the rest fit the memory limit.
+ * @brief The blocks stay in memory when the file can not be written.
+ */
+void CScrollback::spill()
+{
+	while ( !mSpillFailed && mPackedBytes > (qint64)mMemoryLimit*1024*1024 && mSpilledBlocks < mBlocks.count() )
+	{
+		Block* b = mBlocks.at(mSpilledBlocks);
+		if ( b->packed.isEmpty() )
+		{
+			/* hot, so are all the newer ones */
+			break;
+		}
+		if ( mSpill == NULL )
+		{
+#if QT_VERSION >= 0x050000
+			QString dir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+#else
+			QString dir = QDesktopServices::storageLocation(QDesktopServices::CacheLocation);
+#endif
+			QDir().mkpath(dir);
+			mSpill = new QTemporaryFile(dir+"/scrollback-XXXXXX");
+			if ( !mSpill->open() )
+			{
+				delete mSpill;
+				mSpill = NULL;
+				mSpillFailed = true;
+				break;
+			}
+		}
+		qint64 offset = allocateSpill(b->size);
+		if ( !mSpill->seek(offset) || mSpill->write(b->packed) != b->size || !mSpill->flush() )
+		{
+			releaseSpill(offset,b->size);
+			break;
+		}
+		b->offset = offset;
+		b->packed = QByteArray();
+		mPackedBytes -= b->size;
+		++mSpilledBlocks;
+	}
+}
+
+/** the first free extent that fits size bytes, else the end of the file */
+qint64 CScrollback::allocateSpill(qint64 size)
+{
+	for( QMap<qint64,qint64>::iterator i=mSpillFree.begin(); i != mSpillFree.end(); ++i )
+	{
+		if ( i.value() >= size )
+		{
+			qint64 offset = i.key();
+			qint64 rest = i.value()-size;
+			mSpillFree.erase(i);
+			if ( rest > 0 )
+			{
+				mSpillFree.insert(offset+size,rest);
+			}
+			return offset;
+		}
+	}
+	qint64 offset = mSpillEnd;
+	mSpillEnd += size;
+	return offset;
+}
+
+/** the extent of a block is free again, it is merged with its neighbours and a free tail is cut off */
+void CScrollback::releaseSpill(qint64 offset, qint64 size)
+{
+	QMap<qint64,qint64>::iterator next = mSpillFree.lowerBound(offset);
+	if ( next != mSpillFree.end() && offset+size == next.key() )
+	{
+		size += next.value();
+		next = mSpillFree.erase(next);
+	}
+	if ( next != mSpillFree.begin() )
+	{
+		QMap<qint64,qint64>::iterator prev = next;
+		--prev;
+		if ( prev.key()+prev.value() == offset )
+		{
+			offset = prev.key();
+			size += prev.value();
+			mSpillFree.erase(prev);
+		}
+	}
+	if ( offset+size >= mSpillEnd )
+	{
+		mSpillEnd = offset;
+		if ( mSpill != NULL )
+		{
+			mSpill->resize(mSpillEnd);
+		}
+	}
+	else
+	{
+		mSpillFree.insert(offset,size);
+	}
+}
+
+/** drop the spill file */
+void CScrollback::closeSpill()
+{
+	delete mSpill;
+	mSpill = NULL;
+	mSpillEnd = 0;
+	mSpillFree.clear();
+}
+
+/** free the cells of a compressed block */
+void CScrollback::unload(Block* b)
+{
+	b->cells = QVector<CCharCell>();
+	b->ends = QVector<int>();
+}
+
+/** cells stored for line n, 0 is the oldest */
+int CScrollback::lineLength(int n)
+{
+	int index;
+	Block* b = block(n,index);
+	return b->ends.at(index) - ( index > 0 ? b->ends.at(index-1) : 0 );
+}
+
+/** the cells of line n, valid until the next append */
+const CCharCell* CScrollback::line(int n)
+{
+	int index;
+	Block* b = block(n,index);
+	return b->cells.constData() + ( index > 0 ? b->ends.at(index-1) : 0 );
+}
+
+/**
+ * @brief Add a line below the newest one.
+ * @brief Trailing blanks in the default style are not stored and the selection is not kept.
+ */
+void CScrollback::append(const CCharCell* cells, int count)
+{
+	if ( mLimit <= 0 )
+	{
+		return;
+	}
+	while ( count > 0 && cells[count-1].codepoint() == ' ' && cells[count-1].style() == 0 )
+	{
+		--count;
+	}
+	if ( mBlocks.isEmpty() || mBlocks.last()->ends.count() >= CSCROLLBACK_BLOCK_LINES )
+	{
+		Block* b = new Block;
+		b->ends.reserve(CSCROLLBACK_BLOCK_LINES);
+		b->lines = 0;
+		b->offset = -1;
+		b->size = 0;
+		b->bloom.fill(0,CSCROLLBACK_BLOOM_BITS/32);
+		mBlocks.append(b);
+		if ( mBlocks.count() > CSCROLLBACK_HOT_BLOCKS )
+		{
+			/* the block leaving the hot window is full and never changes again */
+			pack(mBlocks.at(mBlocks.count()-CSCROLLBACK_HOT_BLOCKS-1));
+		}
+	}
+	Block* b = mBlocks.last();
+	int start = b->cells.count();
+	b->cells.resize(start+count);
+	CCharCell* to = b->cells.data()+start;
+	memcpy(to,cells,count*sizeof(CCharCell));
+	for( int n=0; n < count; n++ )
+	{
+		to[n].setSelect(false);
+	}
+	for( int n=0; n+2 < count; n++ )
+	{
+		quint32 h = trigram(fold(to[n].codepoint()),fold(to[n+1].codepoint()),fold(to[n+2].codepoint()));
+		quint32 bit1 = h & (CSCROLLBACK_BLOOM_BITS-1);
+		quint32 bit2 = (h >> 16) & (CSCROLLBACK_BLOOM_BITS-1);
+		b->bloom[bit1/32] |= 1u << (bit1%32);
+		b->bloom[bit2/32] |= 1u << (bit2%32);
+	}
+	b->ends.append(start+count);
+	++b->lines;
+	++mLines;
+	trim();
+}
+
+/** set the bit of every style id a line uses, compressed blocks answer from their list of ids */
+void CScrollback::markStyles(QBitArray& used)
+{
+	for( int n=0; n < mBlocks.count(); n++ )
+	{
+		Block* b = mBlocks.at(n);
+		if ( !b->packed.isEmpty() || b->offset >= 0 )
+		{
+			for( int i=0; i < b->styles.count(); i++ )
+			{
+				used.setBit(b->styles.at(i));
+			}
+		}
+		else
+		{
+			for( int i=0; i < b->cells.count(); i++ )
+			{
+				used.setBit(b->cells.at(i).style());
+			}
+		}
+	}
+}
+
+/** drop the oldest lines beyond the limit, a block is freed once all of its lines are dropped */
+void CScrollback::trim()
+{
+	while ( mLines > mLimit )
+	{
+		--mLines;
+		if ( ++mFirst >= CSCROLLBACK_BLOCK_LINES )
+		{
+			Block* b = mBlocks.takeFirst();
+			mUnpacked.removeOne(b);
+			if ( b->offset >= 0 )
+			{
+				if ( --mSpilledBlocks == 0 )
+				{
+					/* nothing left in the spill file, start it over */
+					closeSpill();
+				}
+				else
+				{
+					releaseSpill(b->offset,b->size);
+				}
+			}
+			else if ( !b->packed.isEmpty() )
+			{
+				mPackedBytes -= b->size;
+			}
+			delete b;
+			mFirst = 0;
+		}
+	}
+	if ( mLines == 0 )
+	{
+		clear();
+	}
+}
+
+/** case folded code point */
+uint CScrollback::fold(uint codepoint)
+{
+	if ( codepoint < 0x80 )
+	{
+		return ( codepoint >= 'A' && codepoint <= 'Z' ) ? codepoint+('a'-'A') : codepoint;
+	}
+	return ( codepoint < 0x10000 ) ? QChar((ushort)codepoint).toLower().unicode() : codepoint;
+}
+
+/** hash of three case folded code points, two filter bits are taken from it */
+quint32 CScrollback::trigram(uint a, uint b, uint c)
+{
+	quint32 h = (a*0x9E3779B1u) ^ (b*0x85EBCA77u) ^ (c*0xC2B2AE3Du);
+	h ^= h >> 15;
+	h *= 0x2C1B3C6Du;
+	h ^= h >> 12;
+	return h;
+}
+
+/** false when the block can not hold text, text shorter than a trigram may be anywhere */
+bool CScrollback::mayContain(Block* b, const QVector<uint>& text)
+{
+	for( int n=0; n+2 < text.count(); n++ )
+	{
+		quint32 h = trigram(text.at(n),text.at(n+1),text.at(n+2));
+		quint32 bit1 = h & (CSCROLLBACK_BLOOM_BITS-1);
+		quint32 bit2 = (h >> 16) & (CSCROLLBACK_BLOOM_BITS-1);
+		if ( !(b->bloom.at(bit1/32) & (1u << (bit1%32))) || !(b->bloom.at(bit2/32) & (1u << (bit2%32))) )
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * @brief Find case folded text in a line.
+ * @param col The first column to try, searching backward the last.
+ * @return The column of the match, -1 when none.
+ */
+int CScrollback::findInLine(const CCharCell* cells, int count, const QVector<uint>& text, int col, bool backward)
+{
+	int len = text.count();
+	int last = count-len;
+	if ( len == 0 || last < 0 )
+	{
+		return -1;
+	}
+	int step = backward ? -1 : 1;
+	for( int n = backward ? qMin(col,last) : qMax(col,0); n >= 0 && n <= last; n += step )
+	{
+		int i=0;
+		while ( i < len && fold(cells[n+i].codepoint()) == text.at(i) )
+		{
+			++i;
+		}
+		if ( i == len )
+		{
+			return n;
+		}
+	}
+	return -1;
+}
+
+/**
+ * @brief Find case folded text, blocks whose filter rules the text out are skipped unread.
+ * @param n The line to start at.
+ * @param col The column to start at, set to the column of the match.
+ * @return The line of the match, -1 when none.
+ */
+int CScrollback::find(const QVector<uint>& text, int n, int& col, bool backward)
+{
+	int checked = -1;
+	while ( n >= 0 && n < mLines )
+	{
+		int blockNo = (n+mFirst)/CSCROLLBACK_BLOCK_LINES;
+		if ( blockNo != checked )
+		{
+			if ( !mayContain(mBlocks.at(blockNo),text) )
+			{
+				n = backward ? (blockNo*CSCROLLBACK_BLOCK_LINES)-mFirst-1 : ((blockNo+1)*CSCROLLBACK_BLOCK_LINES)-mFirst;
+				col = backward ? INT_MAX : 0;
+				continue;
+			}
+			checked = blockNo;
+		}
+		int found = findInLine(line(n),lineLength(n),text,col,backward);
+		if ( found >= 0 )
+		{
+			col = found;
+			return n;
+		}
+		n += backward ? -1 : 1;
+		col = backward ? INT_MAX : 0;
+	}
+	return -1;
+}
@@ -0,0 +1,116 @@
+/**************************************************************************
+*   Author <mike@pikeaero.com> Mike Sharkey                               *
+*   Copyright (C) 2010 by Pike Aerospace Research Corporation             *
+*                                                                         *
+*   This program is free software: you can redistribute it and/or modify  *
+*   it under the terms of the GNU General Public License as published by  *
+*   the Free Software Foundation, either version 3 of the License, or     *
+*   (at your option) any later version.                                   *
+*                                                                         *
+*   This program is distributed in the hope that it will be useful,       *
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+*   GNU General Public License for more details.                          *
+*                                                                         *
+*   You should have received a copy of the GNU General Public License     *
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+**************************************************************************/
+#ifndef CSCROLLBACK_H
+#define CSCROLLBACK_H
+
+#include <QList>
+#include <QMap>
+#include <QVector>
+#include <QByteArray>
+#include <QBitArray>
+
+#include "ccharcell.h"
+
+class QTemporaryFile;
+
+#define CSCROLLBACK_BLOCK_LINES		1024		/* lines per block, whole blocks are allocated and dropped */
+#define CSCROLLBACK_DEFAULT_LINES	100000		/* default line limit */
+#define CSCROLLBACK_HOT_BLOCKS		2			/* newest blocks kept uncompressed */
+#define CSCROLLBACK_CACHE_BLOCKS	4			/* older blocks kept unpacked after being read */
+#define CSCROLLBACK_DEFAULT_MEMORY	32			/* default MB of compressed blocks kept in memory */
+#define CSCROLLBACK_BLOOM_BITS		65536		/* bits in the trigram filter of a block, a power of two */
+
+/**
+ * @brief The lines that scrolled off the top of the screen.
+ * @brief Each line is kept as the cells up to its last non-blank one, so history costs what the
+ * @brief text needs rather than a full row. Cells keep the style id they had on the screen.
+ * @brief Lines are packed into blocks of CSCROLLBACK_BLOCK_LINES lines, the oldest lines are
+ * @brief dropped once the line limit is reached.
+ * @brief Blocks older than the newest CSCROLLBACK_HOT_BLOCKS are compressed, reading a line of one
+ * @brief unpacks it into a small cache of recently read blocks.
+ * @brief Once the compressed blocks exceed the memory limit the oldest are written to a spill file
+ * @brief in the cache directory and read back through a memory map of the one block. The space of
+ * @brief blocks dropped from the file is reused, so the file stays about the size of what it holds.
+ * @brief Every block keeps a bloom filter of the case folded trigrams of its lines, so a search
+ * @brief only unpacks the blocks that may hold the text. A compressed block also keeps the style ids
+ * @brief its lines use, so the style table can find the ids in use without unpacking anything.
+ */
+class CScrollback
+{
+	public:
+		CScrollback();
+		virtual ~CScrollback();
+
+		inline int			lines()								{return mLines;}
+		inline int			limit()								{return mLimit;}
+		inline int			memoryLimit()						{return mMemoryLimit;}	/** MB of compressed blocks kept in memory */
+		inline int			spilledBlocks()						{return mSpilledBlocks;}
+		int					lineLength(int n);					/** cells stored for line n, 0 is the oldest */
+		const CCharCell*	line(int n);						/** the cells of line n, valid until the next call */
+		int					compressedBlocks();					/** blocks held compressed */
+		int					find(const QVector<uint>& text, int n, int& col, bool backward);	/** the line holding case folded text from line n, col, -1 when none */
+
+		static uint			fold(uint codepoint);				/** case folded code point */
+		static int			findInLine(const CCharCell* cells, int count, const QVector<uint>& text, int col, bool backward);	/** column of case folded text from col, -1 when none */
+
+		void				setLimit(int lines);
+		void				setMemoryLimit(int mb);
+		void				append(const CCharCell* cells, int count);	/** add a line, trailing blanks are dropped */
+		void				markStyles(QBitArray& used);		/** set the bit of every style id a line uses */
+		void				clear();
+
+	private:
+		typedef struct
+		{
+			QVector<CCharCell>	cells;							/** the lines back to back */
+			QVector<int>		ends;							/** by line, the end of the line in cells */
+			QByteArray			packed;							/** compressed ends and cells, empty while hot or spilled */
+			int					lines;							/** lines in the block, also while unloaded */
+			qint64				offset;							/** where the compressed block is in the spill file, -1 when in memory */
+			int					size;							/** bytes compressed */
+			QVector<quint32>	bloom;							/** trigrams of the lines, CSCROLLBACK_BLOOM_BITS bits */
+			QVector<quint16>	styles;							/** the style ids of the lines once compressed, ascending */
+		} Block;
+
+		Block*				block(int n, int& index);			/** the block of line n and the line within it */
+		void				trim();
+		void				pack(Block* b);
+		void				unpack(Block* b);
+		void				unload(Block* b);
+		void				spill();
+		qint64				allocateSpill(qint64 size);			/** where to write size bytes in the spill file */
+		void				releaseSpill(qint64 offset, qint64 size);	/** give back the extent of a dropped block */
+		void				closeSpill();
+		static quint32		trigram(uint a, uint b, uint c);
+		bool				mayContain(Block* b, const QVector<uint>& text);
+
+		QList<Block*>		mBlocks;							/** oldest first, all but the last are full */
+		int					mFirst;								/** lines already dropped from the first block */
+		QList<Block*>		mUnpacked;							/** compressed blocks unpacked for reading, most recent first */
+		int					mLines;
+		int					mLimit;
+		int					mMemoryLimit;
+		qint64				mPackedBytes;						/** compressed bytes held in memory */
+		int					mSpilledBlocks;						/** the first blocks, held in the spill file */
+		QTemporaryFile*		mSpill;								/** removed when closed */
+		bool				mSpillFailed;						/** the spill file could not be created, keep everything in memory */
+		qint64				mSpillEnd;							/** the end of the last extent in use */
+		QMap<qint64,qint64>	mSpillFree;							/** unused extents before mSpillEnd, offset to size, never adjacent */
+};
+
+#endif // CSCROLLBACK_H
@@ -16,6 +16,7 @@
 *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
 **************************************************************************/
 #include "cserial.h"
+#include "cserialthread.h"
 #include <fcntl.h>
 
 #include <QTimer>
@@ -38,6 +39,10 @@ CSerial::CSerial(const QString& name)
 , mInGetChar(false)
 , mDeviceLock(name)
 , mEmitChars(true)
+, mReadBuffer(CSERIAL_READ_BUFFER_SIZE,'\0')
+, mThreadedRead(false)
+, mRxRing(NULL)
+, mRxThread(NULL)
 {
 #ifdef Q_OS_WIN32
 	mWin32Serial = new CWin32Serial();
@@ -83,12 +88,13 @@ bool CSerial::open()
 		{
 			mDeviceLock.lock();
 			setLineControl();
+			startRxThread();
 			return true;
 		}
 		return false;
 	#else
 		mHandle = ::open( name().toLatin1().data(), O_RDWR | O_NOCTTY | O_NDELAY );
-		if ( mHandle >= 0 )
+		if ( mHandle >= 0 && !threadedRead() )
 		{
 			mSocketNotifier = new QSocketNotifier(mHandle,QSocketNotifier::Read);
 			QObject::connect(mSocketNotifier,SIGNAL(activated(int)),this,SLOT(readActivated(int)));
@@ -97,6 +103,7 @@ bool CSerial::open()
 		{
 			mDeviceLock.lock();
 			setLineControl();
+			startRxThread();
 			return true;
 		}
 		return false;
@@ -118,6 +125,12 @@ void CSerial::close()
 		delete mSocketNotifier;
 		mSocketNotifier = NULL;
 	}
+	stopRxThread();
+	if ( mRxRing != NULL )
+	{
+		delete mRxRing;
+		mRxRing = NULL;
+	}
 #ifdef Q_OS_WIN32
 	mWin32Serial->Close();
 	mDeviceLock.unlock();
@@ -131,6 +144,89 @@ void CSerial::close()
 #endif
 }
 
+/** ***************************************************************************
+* @brief Start the I/O thread if threaded reading was requested and chars are being emitted.
+* @brief The ring outlives the thread so bytes it holds survive a setEmitChars() round trip.
+******************************************************************************/
+void CSerial::startRxThread()
+{
+	if ( threadedRead() && emitChars() && mRxThread == NULL )
+	{
+		if ( mRxRing == NULL )
+		{
+			mRxRing = new CRingBuffer();
+		}
+		mRxThread = new CSerialThread(this,mRxRing);
+		QObject::connect(mRxThread,SIGNAL(dataAvailable()),this,SLOT(readRing()),Qt::QueuedConnection);
+		mRxThread->start();
+		if ( !mRxRing->isEmpty() )
+		{
+			QMetaObject::invokeMethod(this,"readRing",Qt::QueuedConnection);
+		}
+	}
+}
+
+/** ***************************************************************************
+* @brief Stop the I/O thread, must happen before the handle is closed.
+******************************************************************************/
+void CSerial::stopRxThread()
+{
+	if ( mRxThread != NULL )
+	{
+		mRxThread->stop();
+		mRxThread->wait();
+		delete mRxThread;
+		mRxThread = NULL;
+	}
+}
+
+/** ***************************************************************************
+* @brief Turn emitting of received chars on or off. With the I/O thread in use the
+* @brief thread only runs while chars are emitted, otherwise it would fill the ring
+* @brief and spin. While it is parked getChar() takes whatever is left in the ring
+* @brief and then reads the device directly.
+******************************************************************************/
+void CSerial::setEmitChars(bool b)
+{
+	mEmitChars=b;
+	if ( isOpen() )
+	{
+		if ( b )
+		{
+			startRxThread();
+		}
+		else
+		{
+			stopRxThread();
+		}
+	}
+}
+
+/** ***************************************************************************
+* @brief The I/O thread has put data in the ring, drain it in as few chunks as possible.
+* @brief The thread is always rearmed, while getChar() is running it consumes the ring
+* @brief itself and hands the remainder back here when it returns.
+******************************************************************************/
+void CSerial::readRing()
+{
+	if ( mRxThread != NULL )
+	{
+		mRxThread->rearm();
+		if ( !mInGetChar && emitChars() )
+		{
+			emit readyRead();
+			int len;
+			const char* data = mRxRing->readPtr(len);
+			while ( len > 0 )
+			{
+				emitChunk(data,len);
+				mRxRing->commitRead(len);
+				data = mRxRing->readPtr(len);
+			}
+		}
+	}
+}
+
 /** ***************************************************************************
 * @brief receive this singal the data is available for reading.
 ******************************************************************************/
@@ -141,11 +237,44 @@ void CSerial::readActivated(int handle)
 		emit readyRead();
 		if ( emitChars() )
 		{
-			char c;
-			while ( getChar(&c) )
-			{
-				emit rx((unsigned char)c);
-			}
+			readChunks();
+		}
+	}
+}
+
+/** ***************************************************************************
+* @brief Drain everything the device has available, one read() per buffer full.
+******************************************************************************/
+void CSerial::readChunks()
+{
+	int n;
+	while ( !mInGetChar && (n=read(mReadBuffer.data(),mReadBuffer.size())) > 0 )
+	{
+		emitChunk(mReadBuffer.constData(),n);
+		if ( n < mReadBuffer.size() )
+		{
+			break;
+		}
+	}
+}
+
+/** ***************************************************************************
+* @brief Emit a chunk of received bytes to whoever is listening.
+* @param data The received bytes.
+* @param len The number of received bytes.
+******************************************************************************/
+void CSerial::emitChunk(const char* data, int len)
+{
+	emit rx(data,len);
+	if ( receivers(SIGNAL(rx(const QByteArray&))) > 0 )
+	{
+		emit rx(QByteArray(data,len));
+	}
+	if ( receivers(SIGNAL(rx(unsigned char))) > 0 )
+	{
+		for( int n=0; n < len; n++ )
+		{
+			emit rx((unsigned char)data[n]);
 		}
 	}
 }
@@ -165,6 +294,21 @@ int CSerial::write(const void* buf, int count)
 #endif
 }
 
+/** ***************************************************************************
+* @brief read whatever bytes are available from the serial device without waiting.
+* @param buf The buffer to read into.
+* @param count The size of the buffer.
+* @return Number of bytes read, zero or less if nothing was available.
+******************************************************************************/
+int CSerial::read(void* buf, int count)
+{
+#ifdef Q_OS_WIN32
+	return mWin32Serial->ReadData(buf,count);
+#else
+	return ::read( mHandle, buf, count);
+#endif
+}
+
 /** ***************************************************************************
 * @brief write an ascii character to output.
 * @param c The byte to write.
@@ -210,19 +354,30 @@ bool CSerial::getChar(char* ch,int msec)
 		QObject::connect(timer, SIGNAL(timeout()), this, SLOT(readTimeout()));
 		mReadTimeout=false;
 		timer->start(msec);
-	#ifdef Q_OS_WIN32
-		while ( (n=mWin32Serial->ReadData(ch,1)) != 1 && !mReadTimeout )
-		{
-			eventLoop.processEvents();
-		}
-	#else
-		while ( (n=read( mHandle, ch, 1)) != 1 && !mReadTimeout )
+		for(;;)
 		{
+			n = 0;
+			if ( mRxRing != NULL )
+			{
+				n = mRxRing->read(ch,1);
+			}
+			if ( n != 1 && mRxThread == NULL )
+			{
+				n = read(ch,1);
+			}
+			if ( n == 1 || mReadTimeout )
+			{
+				break;
+			}
 			eventLoop.processEvents();
 		}
-	#endif
 		delete timer;
 		mInGetChar=false;
+		if ( mRxThread != NULL && !mRxRing->isEmpty() )
+		{
+			/* wakeups that arrived while we were reading were swallowed, pick up the rest */
+			QMetaObject::invokeMethod(this,"readRing",Qt::QueuedConnection);
+		}
 		return ( n == 1 ) ? true : false;
 	}
 	return false;
@@ -422,18 +577,14 @@ void CSerial::windowsEmitLastError()
 #ifdef Q_OS_WIN32
 void CSerial::timerEvent(QTimerEvent* e)
 {
-	if ( mTimer == e->timerId() )
+	if ( mTimer == e->timerId() && mRxThread == NULL )
 	{
 		if ( mWin32Serial->ReadDataWaiting() )
 		{
 			emit readyRead();
 			if ( emitChars() )
 			{
-				char c;
-				while ( getChar(&c) )
-				{
-					emit rx((unsigned char)c);
-				}
+				readChunks();
 			}
 		}
 	}
@@ -32,6 +32,11 @@
 #endif
 
 #include "cdevicelock.h"
+#include "cringbuffer.h"
+
+#define CSERIAL_READ_BUFFER_SIZE	8192	/* bytes pulled from the device per read() */
+
+class CSerialThread;
 
 /**
  * @brief Implements a serial data class. Currently is intened to implement RS232 style device interface
@@ -57,22 +62,34 @@ class CSerial : public QObject
 		bool				isOpen();
 		void				setLineControl(int ispeed=2400, int dataBits=8, int stopBits=1, QString parity="NONE", QString flow="NONE" );
 		int					write(const void* buf, int count);
+		int					read(void* buf, int count);
 		bool				getChar(char* ch, int msec=100);
 		bool				emitChars() {return mEmitChars;}
+		bool				threadedRead() {return mThreadedRead;}
 
 	public slots:
-		void				setEmitChars(bool b) {mEmitChars=b;}
+		void				setEmitChars(bool b);
+		void				setThreadedRead(bool b) {mThreadedRead=b;}	/** read on an I/O thread, takes effect on open() */
 		void				sendAsciiChar(const char c);
 		void				sendAsciiString(const char* s);
 
 	signals:
 		void				statusMessage( void* sender, int level, QString msg);
 		void				readyRead();
-		void				rx(unsigned char c);
+		void				rx(const QByteArray& data);				/** a chunk of received bytes */
+		void				rx(const char* data, int len);			/** a chunk of received bytes, valid only during the emit */
+		void				rx(unsigned char c);					/** compatibility, one signal per received byte */
 
 	private slots:
 		void				readActivated(int handle);
 		void				readTimeout();
+		void				readRing();
+
+	private:
+		void				startRxThread();
+		void				stopRxThread();
+		void				readChunks();
+		void				emitChunk(const char* data, int len);
 
 	#ifdef Q_OS_WIN32
 	protected:
@@ -93,6 +110,10 @@ class CSerial : public QObject
 		bool				mInGetChar;
 		CDeviceLock         mDeviceLock;
 		bool				mEmitChars;
+		QByteArray			mReadBuffer;							/** reusable receive buffer */
+		bool				mThreadedRead;							/** receive on an I/O thread? */
+		CRingBuffer*		mRxRing;								/** I/O thread to GUI thread receive ring */
+		CSerialThread*		mRxThread;								/** the I/O thread */
 };
 
 #endif
@@ -0,0 +1,114 @@
+/**************************************************************************
+*   Author <mike@pikeaero.com> Mike Sharkey                               *
+*   Copyright (C) 2010 by Pike Aerospace Research Corporation             *
+*                                                                         *
+*   This program is free software: you can redistribute it and/or modify  *
+*   it under the terms of the GNU General Public License as published by  *
+*   the Free Software Foundation, either version 3 of the License, or     *
+*   (at your option) any later version.                                   *
+*                                                                         *
+*   This program is distributed in the hope that it will be useful,       *
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+*   GNU General Public License for more details.                          *
+*                                                                         *
+*   You should have received a copy of the GNU General Public License     *
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+**************************************************************************/
+#include "cserialthread.h"
+#include "cserial.h"
+
+#ifndef Q_OS_WIN32
+	#include <poll.h>
+#endif
+
+#define inherited QThread
+
+CSerialThread::CSerialThread(CSerial* serial, CRingBuffer* ring)
+: inherited()
+, mSerial(serial)
+, mRing(ring)
+, mStop(0)
+, mWakeupPending(0)
+{
+}
+
+CSerialThread::~CSerialThread()
+{
+	stop();
+	wait();
+}
+
+/**
+ * @brief Request the reader loop to terminate.
+ */
+void CSerialThread::stop()
+{
+	mStop.storeRelease(1);
+}
+
+/**
+ * @brief Called by the consumer before it drains the ring.
+ */
+void CSerialThread::rearm()
+{
+	mWakeupPending.storeRelease(0);
+}
+
+/**
+ * @brief Notify the consumer unless a notification is still outstanding.
+ */
+void CSerialThread::wakeup()
+{
+	if ( mWakeupPending.testAndSetOrdered(0,1) )
+	{
+		emit dataAvailable();
+	}
+}
+
+/**
+ * @brief The reader loop. Pulls from the device into the ring until stopped.
+ */
+void CSerialThread::run()
+{
+	while ( !mStop.loadAcquire() )
+	{
+		int len;
+		char* p = mRing->writePtr(len);
+		if ( len == 0 )
+		{
+			/* ring is full, leave the data in the device until the consumer catches up */
+			wakeup();
+			msleep(1);
+			continue;
+		}
+	#ifdef Q_OS_WIN32
+		int n = mSerial->read(p,len);
+		if ( n <= 0 )
+		{
+			msleep(1);
+			continue;
+		}
+	#else
+		struct pollfd pfd;
+		pfd.fd = mSerial->handle();
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+		if ( ::poll(&pfd,1,CSERIALTHREAD_POLL_MSEC) <= 0 )
+		{
+			continue;
+		}
+		int n = mSerial->read(p,len);
+		if ( n <= 0 )
+		{
+			if ( pfd.revents & (POLLERR|POLLHUP|POLLNVAL) )
+			{
+				msleep(CSERIALTHREAD_POLL_MSEC);
+			}
+			continue;
+		}
+	#endif
+		mRing->commitWrite(n);
+		wakeup();
+	}
+}
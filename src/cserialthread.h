@@ -0,0 +1,61 @@
+/**************************************************************************
+*   Author <mike@pikeaero.com> Mike Sharkey                               *
+*   Copyright (C) 2010 by Pike Aerospace Research Corporation             *
+*                                                                         *
+*   This program is free software: you can redistribute it and/or modify  *
+*   it under the terms of the GNU General Public License as published by  *
+*   the Free Software Foundation, either version 3 of the License, or     *
+*   (at your option) any later version.                                   *
+*                                                                         *
+*   This program is distributed in the hope that it will be useful,       *
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+*   GNU General Public License for more details.                          *
+*                                                                         *
+*   You should have received a copy of the GNU General Public License     *
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+**************************************************************************/
+#ifndef CSERIALTHREAD_H
+#define CSERIALTHREAD_H
+
+#include <QThread>
+#include <QAtomicInt>
+
+#include "cringbuffer.h"
+
+#define CSERIALTHREAD_POLL_MSEC		50		/* how often the reader checks for a stop request */
+
+class CSerial;
+
+/**
+ * @brief Owns the receive side of a CSerial device on a thread of its own.
+ * @brief Bytes are read straight into a CRingBuffer, the consumer is woken up with
+ * @brief dataAvailable() at most once until it calls rearm(), so a slow consumer
+ * @brief costs one queued event rather than one per read().
+ */
+class CSerialThread : public QThread
+{
+	Q_OBJECT
+	public:
+		CSerialThread(CSerial* serial, CRingBuffer* ring);
+		virtual ~CSerialThread();
+
+		void				stop();									/** ask run() to return, then wait() */
+		void				rearm();								/** consumer is about to drain, allow the next wakeup */
+
+	signals:
+		void				dataAvailable();						/** the ring went from drained to not drained */
+
+	protected:
+		void				run();
+
+	private:
+		void				wakeup();
+
+		CSerial*			mSerial;
+		CRingBuffer*		mRing;
+		QAtomicInt			mStop;
+		QAtomicInt			mWakeupPending;
+};
+
+#endif // CSERIALTHREAD_H
@@ -0,0 +1,298 @@
+/**************************************************************************
+*   Author <mike@pikeaero.com> Mike Sharkey                               *
+*   Copyright (C) 2010 by Pike Aerospace Research Corporation             *
+*                                                                         *
+*   This program is free software: you can redistribute it and/or modify  *
+*   it under the terms of the GNU General Public License as published by  *
+*   the Free Software Foundation, either version 3 of the License, or     *
+*   (at your option) any later version.                                   *
+*                                                                         *
+*   This program is distributed in the hope that it will be useful,       *
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+*   GNU General Public License for more details.                          *
+*                                                                         *
+*   You should have received a copy of the GNU General Public License     *
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+**************************************************************************/
+#include "csimd.h"
+
+#if defined(__GNUC__) && ( defined(__x86_64__) || defined(__i386__) ) && defined(__SSE2__)
+	#define CSIMD_X86 1
+	#include <immintrin.h>
+#endif
+
+#include <string.h>
+
+#define CSIMD_DEL	0x7F
+#define CSIMD_CSI	0x9B
+
+/** true when the CPU reports AVX2, asked once */
+bool CSimd::hasAVX2()
+{
+#if defined(CSIMD_X86)
+	static int avx2 = -1;
+	if ( avx2 < 0 )
+	{
+		__builtin_cpu_init();
+		avx2 = __builtin_cpu_supports("avx2") ? 1 : 0;
+	}
+	return avx2 != 0;
+#else
+	return false;
+#endif
+}
+
+/**
+ * @brief Find the first byte which is not plain printable text.
+ * @param data The bytes to scan.
+ * @param len The number of bytes to scan.
+ * @return The offset of the first byte below 0x20, DEL or 8-bit CSI, or len if there is none.
+ */
+int CSimd::findControl(const char* data, int len)
+{
+#if defined(CSIMD_X86)
+	return hasAVX2() ? findControlAVX2(data,len) : findControlSSE2(data,len);
+#else
+	return findControlScalar(data,len);
+#endif
+}
+
+/**
+ * @brief Find a byte string.
+ * @brief Candidates are the positions where both the first and the last byte of text match,
+ * @brief a vector of positions is filtered at once and only the candidates are compared in full.
+ * @return The offset of the first occurrence, or len if there is none.
+ */
+int CSimd::findText(const char* data, int len, const char* text, int textLen)
+{
+	if ( textLen <= 0 || textLen > len )
+	{
+		return ( textLen <= 0 ) ? 0 : len;
+	}
+#if defined(CSIMD_X86)
+	return hasAVX2() ? findTextAVX2(data,len,text,textLen) : findTextSSE2(data,len,text,textLen);
+#else
+	return findTextScalar(data,len,text,textLen);
+#endif
+}
+
+/**
+ * @brief Count the occurrences of a byte, line feeds for line numbers for instance.
+ */
+int CSimd::countByte(const char* data, int len, char byte)
+{
+#if defined(CSIMD_X86)
+	return hasAVX2() ? countByteAVX2(data,len,byte) : countByteSSE2(data,len,byte);
+#else
+	return countByteScalar(data,len,byte);
+#endif
+}
+
+/** byte at a time, used for the tails and on non-x86 builds */
+int CSimd::findControlScalar(const char* data, int len)
+{
+	const unsigned char* p = (const unsigned char*)data;
+	for( int n=0; n < len; n++ )
+	{
+		if ( p[n] < ' ' || p[n] == CSIMD_DEL || p[n] == CSIMD_CSI )
+		{
+			return n;
+		}
+	}
+	return len;
+}
+
+/** memchr for the first byte then a compare, used for the tails and on non-x86 builds */
+int CSimd::findTextScalar(const char* data, int len, const char* text, int textLen)
+{
+	int n=0;
+	while ( n+textLen <= len )
+	{
+		const char* p = (const char*)memchr(data+n,text[0],(len-textLen+1)-n);
+		if ( p == NULL )
+		{
+			break;
+		}
+		n = p-data;
+		if ( memcmp(p+1,text+1,textLen-1) == 0 )
+		{
+			return n;
+		}
+		++n;
+	}
+	return len;
+}
+
+/** byte at a time, used for the tails and on non-x86 builds */
+int CSimd::countByteScalar(const char* data, int len, char byte)
+{
+	int count=0;
+	for( int n=0; n < len; n++ )
+	{
+		if ( data[n] == byte )
+		{
+			++count;
+		}
+	}
+	return count;
+}
+
+#if defined(CSIMD_X86)
+
+/** 16 bytes at a time, a byte is below 0x20 when min(byte,0x1F) == byte */
+int CSimd::findControlSSE2(const char* data, int len)
+{
+	const __m128i c1f = _mm_set1_epi8(0x1F);
+	const __m128i del = _mm_set1_epi8((char)CSIMD_DEL);
+	const __m128i csi = _mm_set1_epi8((char)CSIMD_CSI);
+	int n=0;
+	for( ; n+16 <= len; n+=16 )
+	{
+		__m128i v = _mm_loadu_si128((const __m128i*)(data+n));
+		__m128i m = _mm_cmpeq_epi8(_mm_min_epu8(v,c1f),v);
+		m = _mm_or_si128(m,_mm_cmpeq_epi8(v,del));
+		m = _mm_or_si128(m,_mm_cmpeq_epi8(v,csi));
+		int bits = _mm_movemask_epi8(m);
+		if ( bits )
+		{
+			return n+__builtin_ctz(bits);
+		}
+	}
+	return n+findControlScalar(data+n,len-n);
+}
+
+/** 32 bytes at a time, only called when the CPU reports AVX2 */
+__attribute__((target("avx2")))
+int CSimd::findControlAVX2(const char* data, int len)
+{
+	const __m256i c1f = _mm256_set1_epi8(0x1F);
+	const __m256i del = _mm256_set1_epi8((char)CSIMD_DEL);
+	const __m256i csi = _mm256_set1_epi8((char)CSIMD_CSI);
+	int n=0;
+	for( ; n+32 <= len; n+=32 )
+	{
+		__m256i v = _mm256_loadu_si256((const __m256i*)(data+n));
+		__m256i m = _mm256_cmpeq_epi8(_mm256_min_epu8(v,c1f),v);
+		m = _mm256_or_si256(m,_mm256_cmpeq_epi8(v,del));
+		m = _mm256_or_si256(m,_mm256_cmpeq_epi8(v,csi));
+		unsigned int bits = (unsigned int)_mm256_movemask_epi8(m);
+		if ( bits )
+		{
+			return n+__builtin_ctz(bits);
+		}
+	}
+	return n+findControlSSE2(data+n,len-n);
+}
+
+/** 16 candidate positions at a time */
+int CSimd::findTextSSE2(const char* data, int len, const char* text, int textLen)
+{
+	const __m128i first = _mm_set1_epi8(text[0]);
+	const __m128i last = _mm_set1_epi8(text[textLen-1]);
+	int n=0;
+	for( ; n+textLen-1+16 <= len; n+=16 )
+	{
+		__m128i f = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(data+n)),first);
+		__m128i l = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(data+n+textLen-1)),last);
+		unsigned int bits = (unsigned int)_mm_movemask_epi8(_mm_and_si128(f,l));
+		while ( bits )
+		{
+			int at = n+__builtin_ctz(bits);
+			if ( memcmp(data+at+1,text+1,textLen-1) == 0 )
+			{
+				return at;
+			}
+			bits &= bits-1;
+		}
+	}
+	int found = findTextScalar(data+n,len-n,text,textLen);
+	return ( found < len-n ) ? n+found : len;
+}
+
+/** 32 candidate positions at a time, only called when the CPU reports AVX2 */
+__attribute__((target("avx2")))
+int CSimd::findTextAVX2(const char* data, int len, const char* text, int textLen)
+{
+	const __m256i first = _mm256_set1_epi8(text[0]);
+	const __m256i last = _mm256_set1_epi8(text[textLen-1]);
+	int n=0;
+	for( ; n+textLen-1+32 <= len; n+=32 )
+	{
+		__m256i f = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(data+n)),first);
+		__m256i l = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(data+n+textLen-1)),last);
+		unsigned int bits = (unsigned int)_mm256_movemask_epi8(_mm256_and_si256(f,l));
+		while ( bits )
+		{
+			int at = n+__builtin_ctz(bits);
+			if ( memcmp(data+at+1,text+1,textLen-1) == 0 )
+			{
+				return at;
+			}
+			bits &= bits-1;
+		}
+	}
+	int found = findTextSSE2(data+n,len-n,text,textLen);
+	return ( found < len-n ) ? n+found : len;
+}
+
+/** 16 bytes at a time */
+int CSimd::countByteSSE2(const char* data, int len, char byte)
+{
+	const __m128i b = _mm_set1_epi8(byte);
+	int count=0;
+	int n=0;
+	for( ; n+16 <= len; n+=16 )
+	{
+		count += __builtin_popcount(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(data+n)),b)));
+	}
+	return count+countByteScalar(data+n,len-n,byte);
+}
+
+/** 32 bytes at a time, only called when the CPU reports AVX2 */
+__attribute__((target("avx2")))
+int CSimd::countByteAVX2(const char* data, int len, char byte)
+{
+	const __m256i b = _mm256_set1_epi8(byte);
+	int count=0;
+	int n=0;
+	for( ; n+32 <= len; n+=32 )
+	{
+		count += __builtin_popcount((unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(data+n)),b)));
+	}
+	return count+countByteSSE2(data+n,len-n,byte);
+}
+
+#else
+
+int CSimd::findControlSSE2(const char* data, int len)
+{
+	return findControlScalar(data,len);
+}
+
+int CSimd::findControlAVX2(const char* data, int len)
+{
+	return findControlScalar(data,len);
+}
+
+int CSimd::findTextSSE2(const char* data, int len, const char* text, int textLen)
+{
+	return findTextScalar(data,len,text,textLen);
+}
+
+int CSimd::findTextAVX2(const char* data, int len, const char* text, int textLen)
+{
+	return findTextScalar(data,len,text,textLen);
+}
+
+int CSimd::countByteSSE2(const char* data, int len, char byte)
+{
+	return countByteScalar(data,len,byte);
+}
+
+int CSimd::countByteAVX2(const char* data, int len, char byte)
+{
+	return countByteScalar(data,len,byte);
+}
+
+#endif
@@ -0,0 +1,45 @@
+/**************************************************************************
+*   Author <mike@pikeaero.com> Mike Sharkey                               *
+*   Copyright (C) 2010 by Pike Aerospace Research Corporation             *
+*                                                                         *
+*   This program is free software: you can redistribute it and/or modify  *
+*   it under the terms of the GNU General Public License as published by  *
+*   the Free Software Foundation, either version 3 of the License, or     *
+*   (at your option) any later version.                                   *
+*                                                                         *
+*   This program is distributed in the hope that it will be useful,       *
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+*   GNU General Public License for more details.                          *
+*                                                                         *
+*   You should have received a copy of the GNU General Public License     *
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+**************************************************************************/
+#ifndef CSIMD_H
+#define CSIMD_H
+
+/**
+ * @brief Vectorized byte scanning used on the receive path and by the log search.
+ * @brief Uses AVX2 when the CPU has it, SSE2 on any other x86-64 and a plain loop elsewhere.
+ */
+class CSimd
+{
+	public:
+		static int			findControl(const char* data, int len);	/** offset of the first C0, DEL or CSI byte, len when none */
+		static int			findText(const char* data, int len, const char* text, int textLen);	/** offset of the first occurrence of text, len when none */
+		static int			countByte(const char* data, int len, char byte);	/** occurrences of byte */
+
+	private:
+		static bool			hasAVX2();
+		static int			findControlScalar(const char* data, int len);
+		static int			findControlSSE2(const char* data, int len);
+		static int			findControlAVX2(const char* data, int len);
+		static int			findTextScalar(const char* data, int len, const char* text, int textLen);
+		static int			findTextSSE2(const char* data, int len, const char* text, int textLen);
+		static int			findTextAVX2(const char* data, int len, const char* text, int textLen);
+		static int			countByteScalar(const char* data, int len, char byte);
+		static int			countByteSSE2(const char* data, int len, char byte);
+		static int			countByteAVX2(const char* data, int len, char byte);
+};
+
+#endif // CSIMD_H
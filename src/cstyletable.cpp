@@ -0,0 +1,231 @@
+/**************************************************************************
+*   Author <mike@pikeaero.com> Mike Sharkey                               *
+*   Copyright (C) 2010 by Pike Aerospace Research Corporation             *
+*                                                                         *
+*   This program is free software: you can redistribute it and/or modify  *
+*   it under the terms of the GNU General Public License as published by  *
+*   the Free Software Foundation, either version 3 of the License, or     *
+*   (at your option) any later version.                                   *
+*                                                                         *
+*   This program is distributed in the hope that it will be useful,       *
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+*   GNU General Public License for more details.                          *
+*                                                                         *
+*   You should have received a copy of the GNU General Public License     *
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+**************************************************************************/
+#include "cstyletable.h"
+#include "ccellarray.h"
+
+#include <string.h>
+
+/* the xterm 256 color layout: the 8 ANSI colors, their bright forms, a 6x6x6 cube and a gray ramp */
+static constexpr QRgb sPalette[256] =
+{
+	0xff000000, 0xffff0000, 0xff00ff00, 0xfff0f00a, 0xff0000ff, 0xffd70fe6, 0xff0af0e6, 0xffffffff,
+	0xff808080, 0xffff5555, 0xff55ff55, 0xffffff55, 0xff5555ff, 0xffff55ff, 0xff55ffff, 0xffffffff,
+	0xff000000, 0xff00005f, 0xff000087, 0xff0000af, 0xff0000d7, 0xff0000ff, 0xff005f00, 0xff005f5f,
+	0xff005f87, 0xff005faf, 0xff005fd7, 0xff005fff, 0xff008700, 0xff00875f, 0xff008787, 0xff0087af,
+	0xff0087d7, 0xff0087ff, 0xff00af00, 0xff00af5f, 0xff00af87, 0xff00afaf, 0xff00afd7, 0xff00afff,
+	0xff00d700, 0xff00d75f, 0xff00d787, 0xff00d7af, 0xff00d7d7, 0xff00d7ff, 0xff00ff00, 0xff00ff5f,
+	0xff00ff87, 0xff00ffaf, 0xff00ffd7, 0xff00ffff, 0xff5f0000, 0xff5f005f, 0xff5f0087, 0xff5f00af,
+	0xff5f00d7, 0xff5f00ff, 0xff5f5f00, 0xff5f5f5f, 0xff5f5f87, 0xff5f5faf, 0xff5f5fd7, 0xff5f5fff,
+	0xff5f8700, 0xff5f875f, 0xff5f8787, 0xff5f87af, 0xff5f87d7, 0xff5f87ff, 0xff5faf00, 0xff5faf5f,
+	0xff5faf87, 0xff5fafaf, 0xff5fafd7, 0xff5fafff, 0xff5fd700, 0xff5fd75f, 0xff5fd787, 0xff5fd7af,
+	0xff5fd7d7, 0xff5fd7ff, 0xff5fff00, 0xff5fff5f, 0xff5fff87, 0xff5fffaf, 0xff5fffd7, 0xff5fffff,
+	0xff870000, 0xff87005f, 0xff870087, 0xff8700af, 0xff8700d7, 0xff8700ff, 0xff875f00, 0xff875f5f,
+	0xff875f87, 0xff875faf, 0xff875fd7, 0xff875fff, 0xff878700, 0xff87875f, 0xff878787, 0xff8787af,
+	0xff8787d7, 0xff8787ff, 0xff87af00, 0xff87af5f, 0xff87af87, 0xff87afaf, 0xff87afd7, 0xff87afff,
+	0xff87d700, 0xff87d75f, 0xff87d787, 0xff87d7af, 0xff87d7d7, 0xff87d7ff, 0xff87ff00, 0xff87ff5f,
+	0xff87ff87, 0xff87ffaf, 0xff87ffd7, 0xff87ffff, 0xffaf0000, 0xffaf005f, 0xffaf0087, 0xffaf00af,
+	0xffaf00d7, 0xffaf00ff, 0xffaf5f00, 0xffaf5f5f, 0xffaf5f87, 0xffaf5faf, 0xffaf5fd7, 0xffaf5fff,
+	0xffaf8700, 0xffaf875f, 0xffaf8787, 0xffaf87af, 0xffaf87d7, 0xffaf87ff, 0xffafaf00, 0xffafaf5f,
+	0xffafaf87, 0xffafafaf, 0xffafafd7, 0xffafafff, 0xffafd700, 0xffafd75f, 0xffafd787, 0xffafd7af,
+	0xffafd7d7, 0xffafd7ff, 0xffafff00, 0xffafff5f, 0xffafff87, 0xffafffaf, 0xffafffd7, 0xffafffff,
+	0xffd70000, 0xffd7005f, 0xffd70087, 0xffd700af, 0xffd700d7, 0xffd700ff, 0xffd75f00, 0xffd75f5f,
+	0xffd75f87, 0xffd75faf, 0xffd75fd7, 0xffd75fff, 0xffd78700, 0xffd7875f, 0xffd78787, 0xffd787af,
+	0xffd787d7, 0xffd787ff, 0xffd7af00, 0xffd7af5f, 0xffd7af87, 0xffd7afaf, 0xffd7afd7, 0xffd7afff,
+	0xffd7d700, 0xffd7d75f, 0xffd7d787, 0xffd7d7af, 0xffd7d7d7, 0xffd7d7ff, 0xffd7ff00, 0xffd7ff5f,
+	0xffd7ff87, 0xffd7ffaf, 0xffd7ffd7, 0xffd7ffff, 0xffff0000, 0xffff005f, 0xffff0087, 0xffff00af,
+	0xffff00d7, 0xffff00ff, 0xffff5f00, 0xffff5f5f, 0xffff5f87, 0xffff5faf, 0xffff5fd7, 0xffff5fff,
+	0xffff8700, 0xffff875f, 0xffff8787, 0xffff87af, 0xffff87d7, 0xffff87ff, 0xffffaf00, 0xffffaf5f,
+	0xffffaf87, 0xffffafaf, 0xffffafd7, 0xffffafff, 0xffffd700, 0xffffd75f, 0xffffd787, 0xffffd7af,
+	0xffffd7d7, 0xffffd7ff, 0xffffff00, 0xffffff5f, 0xffffff87, 0xffffffaf, 0xffffffd7, 0xffffffff,
+	0xff080808, 0xff121212, 0xff1c1c1c, 0xff262626, 0xff303030, 0xff3a3a3a, 0xff444444, 0xff4e4e4e,
+	0xff585858, 0xff626262, 0xff6c6c6c, 0xff767676, 0xff808080, 0xff8a8a8a, 0xff949494, 0xff9e9e9e,
+	0xffa8a8a8, 0xffb2b2b2, 0xffbcbcbc, 0xffc6c6c6, 0xffd0d0d0, 0xffdadada, 0xffe4e4e4, 0xffeeeeee
+};
+
+CStyleTable::CStyleTable()
+: mCells(NULL)
+, mMisses(0)
+{
+	/* id 0 is the default colors with no attributes */
+	Style s;
+	s.foreground = defaultColor;
+	s.background = defaultColor;
+	s.attributes = 0;
+	mStyles.append(s);
+	mIds.insert(s,0);
+	resetPalette();
+}
+
+CStyleTable::~CStyleTable()
+{
+}
+
+/** the RGB value of a palette index before any change */
+QRgb CStyleTable::defaultPaletteColor(int n)
+{
+	return sPalette[n & 0xff];
+}
+
+/** change a palette entry, cells are not touched */
+void CStyleTable::setPaletteColor(int n, QRgb rgb)
+{
+	mPalette[n & 0xff] = rgb | 0xff000000;
+}
+
+void CStyleTable::resetPalette(int n)
+{
+	if ( n < 0 )
+	{
+		memcpy(mPalette,sPalette,sizeof(mPalette));
+	}
+	else
+	{
+		mPalette[n & 0xff] = sPalette[n & 0xff];
+	}
+}
+
+/**
+ * @brief Intern a rendition.
+ * @param fg The foreground, defaultColor for the screen default.
+ * @param bg The background, defaultColor for the screen default.
+ * @return The id to store in cells, the rendition of an id does not change while a cell uses it.
+ */
+quint16 CStyleTable::intern(QRgb fg, QRgb bg, quint16 attributes)
+{
+	Style s;
+	s.foreground = fg;
+	s.background = bg;
+	s.attributes = attributes;
+	QHash<Style,quint16>::const_iterator i = mIds.constFind(s);
+	if ( i != mIds.constEnd() )
+	{
+		return i.value();
+	}
+	if ( mFree.isEmpty() && mStyles.count() >= CSTYLETABLE_MAX_STYLES )
+	{
+		collect();
+	}
+	quint16 id;
+	if ( !mFree.isEmpty() )
+	{
+		id = mFree.last();
+		mFree.remove(mFree.count()-1);
+		mStyles[id] = s;
+	}
+	else if ( mStyles.count() < CSTYLETABLE_MAX_STYLES )
+	{
+		id = mStyles.count();
+		mStyles.append(s);
+	}
+	else
+	{
+		return nearest(s);
+	}
+	mIds.insert(s,id);
+	return id;
+}
+
+/**
+ * @brief Free the ids no cell, history line or current rendition refers to.
+ * @brief A collection that frees little is not repeated until CSTYLETABLE_COLLECT_MISSES more interns
+ * @brief found the table full, so a screen that really uses every id is not scanned on every change.
+ */
+void CStyleTable::collect()
+{
+	if ( mMisses > 0 )
+	{
+		--mMisses;
+		return;
+	}
+	if ( mCells == NULL )
+	{
+		return;
+	}
+	QBitArray used(mStyles.count());
+	used.setBit(0);
+	mCells->markStyles(used);
+	for( int id=mStyles.count()-1; id > 0; id-- )
+	{
+		if ( !used.testBit(id) )
+		{
+			mIds.remove(mStyles.at(id));
+			mFree.append(id);
+		}
+	}
+	mMisses = qMax(CSTYLETABLE_COLLECT_MISSES-mFree.count(),0);
+}
+
+/** the id of the existing rendition closest to s, a different attribute weighs more than any color */
+quint16 CStyleTable::nearest(const Style& s)
+{
+	quint16 best = 0;
+	qint64 bestDistance = -1;
+	for( int id=0; id < mStyles.count() && bestDistance != 0; id++ )
+	{
+		const Style& t = mStyles.at(id);
+		qint64 d = distance(s.foreground,t.foreground) + distance(s.background,t.background);
+		if ( s.attributes != t.attributes )
+		{
+			d += 2*3*255*255;
+		}
+		if ( bestDistance < 0 || d < bestDistance )
+		{
+			best = id;
+			bestDistance = d;
+		}
+	}
+	return best;
+}
+
+/** squared RGB distance of two colors, the screen default is only close to itself */
+qint64 CStyleTable::distance(QRgb a, QRgb b)
+{
+	if ( a == b )
+	{
+		return 0;
+	}
+	if ( a == defaultColor || b == defaultColor )
+	{
+		return 3*255*255;
+	}
+	a = rgb(a);
+	b = rgb(b);
+	qint64 r = qRed(a)-qRed(b);
+	qint64 g = qGreen(a)-qGreen(b);
+	qint64 bl = qBlue(a)-qBlue(b);
+	return r*r + g*g + bl*bl;
+}
+
+quint16 CStyleTable::withForeground(quint16 id, QRgb fg)
+{
+	const Style& s = style(id);
+	return ( s.foreground == fg ) ? id : intern(fg,s.background,s.attributes);
+}
+
+quint16 CStyleTable::withBackground(quint16 id, QRgb bg)
+{
+	const Style& s = style(id);
+	return ( s.background == bg ) ? id : intern(s.foreground,bg,s.attributes);
+}
+
+quint16 CStyleTable::withAttribute(quint16 id, quint16 attribute, bool on)
+{
+	const Style& s = style(id);
+	quint16 attributes = on ? ( s.attributes | attribute ) : ( s.attributes & ~attribute );
+	return ( s.attributes == attributes ) ? id : intern(s.foreground,s.background,attributes);
+}
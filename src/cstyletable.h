@@ -0,0 +1,112 @@
+/**************************************************************************
+*   Author <mike@pikeaero.com> Mike Sharkey                               *
+*   Copyright (C) 2010 by Pike Aerospace Research Corporation             *
+*                                                                         *
+*   This program is free software: you can redistribute it and/or modify  *
+*   it under the terms of the GNU General Public License as published by  *
+*   the Free Software Foundation, either version 3 of the License, or     *
+*   (at your option) any later version.                                   *
+*                                                                         *
+*   This program is distributed in the hope that it will be useful,       *
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+*   GNU General Public License for more details.                          *
+*                                                                         *
+*   You should have received a copy of the GNU General Public License     *
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+**************************************************************************/
+
+#ifndef CSTYLETABLE_H
+#define CSTYLETABLE_H
+
+#include <QVector>
+#include <QHash>
+#include <QBitArray>
+#include <QColor>
+
+#define CSTYLETABLE_MAX_STYLES		65536		/* style ids are 16 bits */
+#define CSTYLETABLE_COLLECT_MISSES	1024		/* interns into a full table between two collections */
+
+class CCellArray;
+
+/**
+ * @brief Interned cell renditions.
+ * @brief Each distinct foreground, background and attribute combination is given a small id the
+ * @brief first time it is used, cells store only the id. Id 0 is the default colors with no
+ * @brief attributes. A color is either defaultColor, which has no alpha and is resolved to the screen
+ * @brief default when drawn, an index into the 256 color palette tagged with indexedColor, or an opaque RGB value.
+ * @brief Palette indexes are looked up when drawn, so changing a palette entry recolors every cell using it.
+ * @brief When every id is taken the ids no cell uses any more are collected and given out again. If
+ * @brief the table is still full a new rendition gets the id of the closest existing one.
+ */
+class CStyleTable
+{
+	public:
+
+		static const  quint16 attrBlink     =   0x0001;   // blink.
+		static const  quint16 attrBold      =   0x0002;   // bold.
+		static const  quint16 attrReverse   =   0x0004;   // reverse.
+		static const  quint16 attrUnderline =   0x0008;   // underline.
+
+		static const  QRgb    defaultColor  =   0;        // the screen default color.
+		static const  QRgb    indexedColor  =   0x01000000; // tag of a palette index.
+
+		typedef struct
+		{
+			QRgb			foreground;
+			QRgb			background;
+			quint16			attributes;
+		} Style;
+
+		CStyleTable();
+		virtual ~CStyleTable();
+
+		inline int			count()								{return mStyles.count()-mFree.count();}	/** ids in use */
+		inline const Style&	style(quint16 id)					{return mStyles.at(id < mStyles.count() ? id : 0);}
+		inline QRgb			foreground(quint16 id)				{return style(id).foreground;}
+		inline QRgb			background(quint16 id)				{return style(id).background;}
+		inline quint16		attributes(quint16 id)				{return style(id).attributes;}
+		inline bool			blink(quint16 id)					{return ( attributes(id) & attrBlink );}
+		inline bool			bold(quint16 id)					{return ( attributes(id) & attrBold );}
+		inline bool			reverse(quint16 id)					{return ( attributes(id) & attrReverse );}
+		inline bool			underline(quint16 id)				{return ( attributes(id) & attrUnderline );}
+
+		static inline QRgb	indexed(int n)						{return indexedColor | (n & 0xff);}		/** a palette color */
+		static inline bool	isIndexed(QRgb color)				{return ( color & 0xff000000 ) == indexedColor;}
+		static inline int	colorIndex(QRgb color)				{return color & 0xff;}
+		static QRgb			defaultPaletteColor(int n);			/** the RGB value of a palette index before any change */
+		inline QRgb			paletteColor(int n)					{return mPalette[n & 0xff];}		/** the RGB value of a palette index */
+		inline QRgb			rgb(QRgb color)						{return isIndexed(color) ? paletteColor(colorIndex(color)) : color;}	/** the RGB value of an indexed or direct color */
+		void				setPaletteColor(int n, QRgb rgb);
+		void				resetPalette(int n=-1);				/** back to the default palette, one entry or all of them */
+
+		void				setCells(CCellArray* cells)			{mCells=cells;}	/** who is asked for the ids in use when the table is full */
+		quint16				intern(QRgb fg, QRgb bg, quint16 attributes);	/** the id of a rendition, the closest one when the table is full */
+		quint16				withForeground(quint16 id, QRgb fg);			/** the id of a rendition with another foreground */
+		quint16				withBackground(quint16 id, QRgb bg);			/** the id of a rendition with another background */
+		quint16				withAttribute(quint16 id, quint16 attribute, bool on);	/** the id of a rendition with an attribute set or cleared */
+
+	private:
+		void				collect();
+		quint16				nearest(const Style& s);
+		qint64				distance(QRgb a, QRgb b);
+
+		QVector<Style>		mStyles;							/** rendition by id */
+		QHash<Style,quint16> mIds;								/** id by rendition */
+		QVector<quint16>	mFree;								/** collected ids, given out before the table grows */
+		CCellArray*			mCells;								/** marks the ids in use */
+		int					mMisses;							/** interns into the full table until the next collection */
+		QRgb				mPalette[256];						/** RGB value by palette index */
+};
+
+inline bool operator==(const CStyleTable::Style& a, const CStyleTable::Style& b)
+{
+	return a.foreground == b.foreground && a.background == b.background && a.attributes == b.attributes;
+}
+
+inline uint qHash(const CStyleTable::Style& s)
+{
+	return ( s.foreground * 31u ) ^ ( s.background * 17u ) ^ ( (uint)s.attributes << 24 ) ^ ( s.background >> 8 );
+}
+
+#endif // CSTYLETABLE_H
@@ -20,11 +20,13 @@
 #include "ui_settingsdialog.h"
 
 #include "cemulationVT102.h"
+#include "clogdialog.h"
 
 #include <QMessageBox>
 #include <QSettings>
 #include <QColorDialog>
 #include <QClipboard>
+#include <QFileDialog>
 
 #ifdef Q_OS_WIN32
 	#include <QWindowsStyle>
@@ -93,6 +95,7 @@ void Komport::readSettings()
 		int		sbits	= settings.value("sbits",		settingsUi->StopBitsComboBox->currentText().toInt()).toInt();
 		QString parity	= settings.value("parity",		settingsUi->ParityComboBox->currentText()).toString();
 		QString flow	= settings.value("flow",		settingsUi->FlowControlComboBox->currentText()).toString();
+		bool	iothread= settings.value("iothread",	true).toBool();
 	settings.endGroup();
 
 	settings.beginGroup("terminal");
@@ -103,6 +106,10 @@ void Komport::readSettings()
 		bool	localecho		= settings.value("localecho",	settingsUi->LocalEchoCheckBox->isChecked()).toBool();
 		QRgb	backgroundColor = settings.value("background",	settingsUi->BackgroundColorButton->palette().color(QPalette::Button).rgb()).toUInt();
 		QRgb	foregroundColor = settings.value("foreground",	settingsUi->ForegroundColorButton->palette().color(QPalette::Button).rgb()).toUInt();
+		bool	statictext		= settings.value("statictext",	false).toBool();
+		int		framerate		= settings.value("framerate",	0).toInt();
+		int		scrollback		= settings.value("scrollback",	CSCROLLBACK_DEFAULT_LINES).toInt();
+		int		scrollbackmemory = settings.value("scrollbackmemory",	CSCROLLBACK_DEFAULT_MEMORY).toInt();
 	settings.endGroup();
 
 	if ( mScreen != NULL ) delete mScreen;
@@ -137,11 +144,16 @@ void Komport::readSettings()
 
 	screen()->setForegroundColor(QColor::fromRgb(foregroundColor));
 	screen()->setBackgroundColor(QColor::fromRgb(backgroundColor));
+	screen()->cells().setStaticText(statictext);
+	screen()->setFrameRate(framerate);
+	screen()->scrollback().setLimit(scrollback);
+	screen()->scrollback().setMemoryLimit(scrollbackmemory);
 
 	setCentralWidget(screen());
 	screen()->setEnabled(true);
 
 	mSerial = new CSerial(device);
+	mSerial->setThreadedRead(iothread);
 	if ( emulation == "VT102" )
 	{
 		mEmulation = new CEmulationVT102(screen());
@@ -179,6 +191,7 @@ void Komport::writeSettings()
 		settings.setValue("sbits",	settingsUi->StopBitsComboBox->currentText().toInt() );
 		settings.setValue("parity",	settingsUi->ParityComboBox->currentText() );
 		settings.setValue("flow",	settingsUi->FlowControlComboBox->currentText() );
+		settings.setValue("iothread", serial()->threadedRead() );
 	settings.endGroup();
 
 	settings.beginGroup("terminal");
@@ -187,8 +200,12 @@ void Komport::writeSettings()
 		settings.setValue("rows",		settingsUi->RowsSpinBox->value());
 		settings.setValue("visualbell",	settingsUi->VisualBellCheckBox->isChecked());
 		settings.setValue("localecho",	settingsUi->LocalEchoCheckBox->isChecked());
-		settings.setValue("foreground", screen()->foregroundColor().rgb());
-		settings.setValue("background", screen()->backgroundColor().rgb());
+		settings.setValue("foreground", settingsUi->ForegroundColorButton->palette().color(QPalette::Button).rgb());
+		settings.setValue("background", settingsUi->BackgroundColorButton->palette().color(QPalette::Button).rgb());
+		settings.setValue("statictext", screen()->cells().staticText());
+		settings.setValue("framerate",	screen()->frameRate());
+		settings.setValue("scrollback",	screen()->scrollback().limit());
+		settings.setValue("scrollbackmemory",	screen()->scrollback().memoryLimit());
 	settings.endGroup();
 }
 
@@ -199,7 +216,7 @@ bool Komport::openSerial()
 	{
 		QObject::connect(emulation(),SIGNAL(sendAsciiChar(char)),serial(),SLOT(sendAsciiChar(char)));
 		QObject::connect(emulation(),SIGNAL(sendAsciiString(const char*)),serial(),SLOT(sendAsciiString(const char*)));
-		QObject::connect(serial(),SIGNAL(rx(unsigned char)),emulation(),SLOT(receiveChar(unsigned char)));
+		QObject::connect(serial(),SIGNAL(rx(const char*,int)),emulation(),SLOT(receiveBytes(const char*,int)));
 		return true;
 	}
 	QMessageBox::warning(this, "Open Failed", "Open '"+settingsUi->DeviceComboBox->currentText()+"' failed");
@@ -209,6 +226,30 @@ bool Komport::openSerial()
 /** Key press handler */
 void Komport::keyPressEvent(QKeyEvent *e)
 {
+	if ( screen()->pageKey(e) )
+	{
+		return;
+	}
+	switch( e->key() )
+	{
+		case Qt::Key_Shift:		/* a modifier on its own leaves the view where it is */
+		case Qt::Key_Control:
+		case Qt::Key_Alt:
+		case Qt::Key_AltGr:
+		case Qt::Key_Meta:
+		case Qt::Key_Super_L:
+		case Qt::Key_Super_R:
+		case Qt::Key_Hyper_L:
+		case Qt::Key_Hyper_R:
+		case Qt::Key_CapsLock:
+		case Qt::Key_NumLock:
+		case Qt::Key_ScrollLock:
+			break;
+		default:
+			screen()->setViewOffset(0);
+			screen()->requestImmediateFrame();
+			break;
+	}
 	emulation()->keyPressEvent(e);
 }
 
@@ -227,8 +268,59 @@ void Komport::doPaste()
 	serial()->sendAsciiString(text.toLatin1().data());
 }
 
+/** Edit->Find */
+void Komport::showSearch()
+{
+	searchToolBar->show();
+	searchEdit->setFocus();
+	searchEdit->selectAll();
+}
+
+/** find the search text below the last match */
+void Komport::findNext()
+{
+	if ( !screen()->find(searchEdit->text(),false) )
+	{
+		statusBar()->showMessage(tr("Not found"),2000);
+	}
+}
+
+/** find the search text above the last match */
+void Komport::findPrevious()
+{
+	if ( !screen()->find(searchEdit->text(),true) )
+	{
+		statusBar()->showMessage(tr("Not found"),2000);
+	}
+}
+
+/** File->Open Log */
+void Komport::openLog()
+{
+	QString path = QFileDialog::getOpenFileName(this,tr("Open Log"));
+	if ( !path.isEmpty() )
+	{
+		CLogDialog* dialog = new CLogDialog(this);
+		dialog->setAttribute(Qt::WA_DeleteOnClose);
+		if ( dialog->open(path) )
+		{
+			dialog->show();
+		}
+		else
+		{
+			QMessageBox::warning(this,tr("Open Log"),tr("Can not read %1").arg(path));
+			delete dialog;
+		}
+	}
+}
+
 void Komport::createActions()
 {
+	openLogAct = new QAction(tr("&Open Log..."), this);
+	openLogAct->setShortcut(tr("Ctrl+Shift+O"));
+	openLogAct->setStatusTip(tr("Search a capture file"));
+	QObject::connect(openLogAct, SIGNAL(triggered()), this, SLOT(openLog()));
+
 	exitAct = new QAction(QIcon(":/images/exit.png"),tr("E&xit"), this);
 	exitAct->setShortcut(tr("Ctrl+Shift+Q"));
 	exitAct->setStatusTip(tr("Exit Komport"));
@@ -244,6 +336,21 @@ void Komport::createActions()
 	pasteAct->setStatusTip(tr("Paste the clipboard's contents."));
 	QObject::connect(pasteAct,SIGNAL(triggered()),this,SLOT(doPaste()));
 
+	findAct = new QAction(tr("&Find..."), this);
+	findAct->setShortcut(tr("Ctrl+Shift+F"));
+	findAct->setStatusTip(tr("Search the scrollback and the screen."));
+	QObject::connect(findAct,SIGNAL(triggered()),this,SLOT(showSearch()));
+
+	findNextAct = new QAction(tr("Find &Next"), this);
+	findNextAct->setShortcut(tr("F3"));
+	findNextAct->setStatusTip(tr("Find the next match below."));
+	QObject::connect(findNextAct,SIGNAL(triggered()),this,SLOT(findNext()));
+
+	findPreviousAct = new QAction(tr("Find Pre&vious"), this);
+	findPreviousAct->setShortcut(tr("Shift+F3"));
+	findPreviousAct->setStatusTip(tr("Find the previous match above."));
+	QObject::connect(findPreviousAct,SIGNAL(triggered()),this,SLOT(findPrevious()));
+
 	settingsAct = new QAction(QIcon(":/images/settings.png"), tr("Se&ttings"), this);
 	settingsAct->setShortcut(tr("Ctrl+Shift+T"));
 	settingsAct->setStatusTip(tr("Edit Kompotr settings"));
@@ -260,11 +367,17 @@ void Komport::createActions()
 void Komport::createMenus()
 {
 	fileMenu = menuBar()->addMenu(tr("&File"));
+	fileMenu->addAction(openLogAct);
+	fileMenu->addSeparator();
 	fileMenu->addAction(exitAct);
 
 	editMenu = menuBar()->addMenu(tr("&Edit"));
 	editMenu->addAction(copyAct);
 	editMenu->addAction(pasteAct);
+	editMenu->addSeparator();
+	editMenu->addAction(findAct);
+	editMenu->addAction(findNextAct);
+	editMenu->addAction(findPreviousAct);
 
 	configMenu = menuBar()->addMenu(tr("&Configuration"));
 	configMenu->addAction(settingsAct);
@@ -289,6 +402,15 @@ void Komport::createToolBars()
 	configToolBar = addToolBar(tr("Configuration"));
 	configToolBar->setObjectName("ConfigToolBar");
 	configToolBar->addAction(settingsAct);
+
+	searchToolBar = addToolBar(tr("Search"));
+	searchToolBar->setObjectName("SearchToolBar");
+	searchEdit = new QLineEdit(searchToolBar);
+	searchToolBar->addWidget(searchEdit);
+	searchToolBar->addAction(findPreviousAct);
+	searchToolBar->addAction(findNextAct);
+	searchToolBar->hide();
+	QObject::connect(searchEdit,SIGNAL(returnPressed()),this,SLOT(findPrevious()));
 }
 
 void Komport::createStatusBar()
@@ -24,6 +24,7 @@
 #include <QDialog>
 #include <QCloseEvent>
 #include <QColor>
+#include <QLineEdit>
 
 #include "cscreen.h"
 #include "cserial.h"
@@ -55,9 +56,13 @@ class Komport : public QMainWindow
 
 	private slots:
 		void				about();
+		void				openLog();
 		void				editSettings();
 		void				doCopy();
 		void				doPaste();
+		void				showSearch();
+		void				findNext();
+		void				findPrevious();
 		void				openBackgroundColorDialog();
 		void				openForegroundColorDialog();
 		void				settingsHelp();
@@ -90,11 +95,17 @@ class Komport : public QMainWindow
 		QToolBar*			fileToolBar;
 		QToolBar*			editToolBar;
 		QToolBar*			configToolBar;
+		QToolBar*			searchToolBar;
+		QLineEdit*			searchEdit;
 
+		QAction*			openLogAct;
 		QAction*			exitAct;
 
 		QAction*			copyAct;
 		QAction*			pasteAct;
+		QAction*			findAct;
+		QAction*			findNextAct;
+		QAction*			findPreviousAct;
 
 		QAction*			settingsAct;
 